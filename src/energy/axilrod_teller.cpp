@@ -1,6 +1,7 @@
 extern "C" {
 #include <mc.h>
 }
+#include <vector>
 // TODO: Make everything C++
 
 // Copyright 2015 Adam Hogan
@@ -81,100 +82,217 @@ Vec& Vec::operator= ( const Vec &right ) {
 	return *this; // allows chaining, i.e. x = y = z;
 }
 
-double axilrod_teller ( system_t *system ) {
-	double potential = 0.0, c9, rij, rik, rjk, cos_part;
-	molecule_t *molecule1, *molecule2, *molecule3;
-	atom_t *atom1, *atom2, *atom3;
-	pair_t temp;
-	Vec ij, ik, jk, a, b;
-
-	for ( molecule1 = system->molecules; molecule1; molecule1 = molecule1->next ) {
-		for ( molecule2 = system->molecules; molecule2; molecule2 = molecule2->next ) {
-			for ( molecule3 = system->molecules; molecule3; molecule3 = molecule3->next ) {
-				int number_of_unique_molecules = 1;
-				if ( molecule2!=molecule1 ) {
-					number_of_unique_molecules++;
-				}
-				if ( molecule3!=molecule1&&molecule3!=molecule2 ) {
-					number_of_unique_molecules++;
-				}
-				if ( number_of_unique_molecules>1 ) {
-					for ( atom1 = molecule1->atoms; atom1; atom1 = atom1->next ) {
-						for ( atom2 = molecule2->atoms; atom2; atom2 = atom2->next ) {
-							for ( atom3 = molecule3->atoms; atom3; atom3 = atom3->next ) {
-								if ( atom1!=atom2&&atom1!=atom3&&atom2!=atom3 ) {
-									
-									double atom1_c9, atom2_c9, atom3_c9;
-									atom1_c9 = atom1->c9;
-									atom2_c9 = atom2->c9;
-									atom3_c9 = atom3->c9;
-									
-									// Axilrod-Teller parameters in http://arxiv.org/pdf/1201.1532.pdf and http://dx.doi.org/10.1063/1.440310
-									// Midzuno-Kihara approximation for c9 http://dx.doi.org/10.1143/JPSJ.11.1045
-									if (system->midzuno_kihara_approx)
-									{
-										atom1_c9 = 3.0/4.0*atom1->polarizability*6.7483345*atom1->c6;
-										atom2_c9 = 3.0/4.0*atom2->polarizability*6.7483345*atom2->c6;
-										atom3_c9 = 3.0/4.0*atom3->polarizability*6.7483345*atom3->c6;
-									}
-									
-									// Mixing rule, ep. 20 of http://dx.doi.org/10.1063/1.440310
-									c9 = pow(pow(atom1->polarizability*6.7483345,3)*pow(atom2->polarizability*6.7483345,3)*pow(atom3->polarizability*6.7483345,3),1.0/3.0) * 
-									3.0/(1.0/(atom1_c9/pow(atom1->polarizability*6.7483345,3))+1.0/(atom2_c9/pow(atom2->polarizability*6.7483345,3))+1.0/(atom3_c9/pow(atom3->polarizability*6.7483345,3)));
-									
-									if ( atom1->polarizability == 0.0 || atom2->polarizability == 0.0 || atom3->polarizability == 0.0 )
-										c9 = 0.0; // avoid division by zero
-									
-									c9 *= 0.0032539449/(3.166811429*0.000001); // convert H*Bohr^9 to K*Angstrom^9
-									
-									// reset fake pair ptr
-									temp.d_prev[0] = temp.d_prev[1] = temp.d_prev[2] = -999999999999.;
-									// get minimum image distance
-									minimum_image ( system,atom1,atom2,&temp );
-									rij = temp.rimg;
-									ij.set ( temp.dimg[0],temp.dimg[1],temp.dimg[2] );
-
-									// reset fake pair ptr
-									temp.d_prev[0] = temp.d_prev[1] = temp.d_prev[2] = -999999999999.;
-									// get minimum image distance
-									minimum_image ( system,atom1,atom3,&temp );
-									rik = temp.rimg;
-									ik.set ( temp.dimg[0],temp.dimg[1],temp.dimg[2] );
-
-									// reset fake pair ptr
-									temp.d_prev[0] = temp.d_prev[1] = temp.d_prev[2] = -999999999999.;
-									// get minimum image distance
-									minimum_image ( system,atom2,atom3,&temp );
-									rjk = temp.rimg;
-									jk.set ( temp.dimg[0],temp.dimg[1],temp.dimg[2] );
-
-									cos_part = 3;
-
-									a = -1.0*ij;
-									b = -1.0*ik;
-
-									cos_part *= a.dot ( b ) / ( a.norm() * b.norm() );
-									
-									a = ij;
-									b = -1.0*jk;
-
-									cos_part *= a.dot ( b ) / ( a.norm() * b.norm() );
-
-									a = ik;
-									b = jk;
-
-									cos_part *= a.dot ( b ) / ( a.norm() * b.norm() );
-									
-									potential += c9*((1.0+cos_part)/pow(rij*rik*rjk,3));
-								}
-							}
-						}
-					}
+// a polarizable site taking part in the three-body sum
+struct at_site {
+	double pos[3];
+	double s;	// polarizability in bohr^3
+	double t;	// s^3/c9, the term of the c9 mixing rule
+	int molecule;
+};
+
+// a pair within the three-body cutoff, kept for every triple that uses it
+struct at_neighbor {
+	int j;
+	double r;
+	Vec d;
+};
+
+// the site of an atom, if it has a three-body energy at all
+static int at_make_site ( system_t *system, atom_t *atom, int molecule, at_site *site ) {
+	double c9 = atom->c9;
+
+	if ( atom->polarizability == 0.0 ) return 0; // c9 = 0, avoid division by zero
+
+	site->s = atom->polarizability*6.7483345;
+	// Axilrod-Teller parameters in http://arxiv.org/pdf/1201.1532.pdf and http://dx.doi.org/10.1063/1.440310
+	// Midzuno-Kihara approximation for c9 http://dx.doi.org/10.1143/JPSJ.11.1045
+	if ( system->midzuno_kihara_approx )
+		c9 = 3.0/4.0*site->s*atom->c6;
+	if ( c9 == 0.0 ) return 0; // the mixing rule gives c9 = 0 for any triple with this atom
+
+	site->t = 1.0/(c9/pow(site->s,3));
+	for ( int p=0; p<3; p++ )
+		site->pos[p] = atom->pos[p];
+	site->molecule = molecule;
+	return 1;
+}
+
+// minimum image separation i-j, same convention as minimum_image()
+static double at_separation ( pbc_t *pbc, const double *pos_i, const double *pos_j, Vec &d ) {
+	double dr[3], img[3];
+
+	for ( int p=0; p<3; p++ )
+		dr[p] = pos_i[p] - pos_j[p];
+	for ( int p=0; p<3; p++ ) {
+		img[p] = 0;
+		for ( int q=0; q<3; q++ )
+			img[p] += pbc->reciprocal_basis[q][p]*dr[q];
+		img[p] = rint(img[p]);
+	}
+	for ( int p=0; p<3; p++ ) {
+		double di = 0;
+		for ( int q=0; q<3; q++ )
+			di += pbc->basis[q][p]*img[q];
+		d.components[p] = dr[p] - di;
+	}
+	return d.norm();
+}
+
+// the pairs j > i of the sites that are within the cutoff (all of them for cutoff 0), binned in a cell list when the cell allows
+static void at_pair_lists ( system_t *system, std::vector<at_site> &site, double cutoff, std::vector<int> &start, std::vector<at_neighbor> &neighbor ) {
+	pbc_t *pbc = system->pbc;
+	int n = site.size(), ncell[3], cell_i[3], cell_j[3], use_cells = ( cutoff > 0 ) && ( pbc->volume > 0 );
+	std::vector<int> cell, cell_head, cell_next;
+	at_neighbor nb;
+
+	// number of cells along each lattice vector, from the spacing of the lattice planes
+	for ( int p=0; p<3; p++ ) {
+		double width = 0;
+		for ( int q=0; q<3; q++ )
+			width += pbc->reciprocal_basis[q][p]*pbc->reciprocal_basis[q][p];
+		ncell[p] = use_cells ? (int)floor(1.0/(sqrt(width)*cutoff)) : 1;
+		// the 27 cell stencil is only unique with at least 3 cells per direction
+		if ( ncell[p] < 3 ) use_cells = 0;
+	}
+
+	if ( use_cells ) {
+		cell.resize(n);
+		cell_next.resize(n);
+		cell_head.assign(ncell[0]*ncell[1]*ncell[2],-1);
+		for ( int i=n-1; i>=0; i-- ) {
+			for ( int p=0; p<3; p++ ) {
+				double s = 0;
+				for ( int q=0; q<3; q++ )
+					s += pbc->reciprocal_basis[q][p]*site[i].pos[q];
+				s -= floor(s);
+				cell_i[p] = (int)(s*ncell[p]);
+				if ( cell_i[p] >= ncell[p] ) cell_i[p] = ncell[p]-1;
+			}
+			cell[i] = (cell_i[0]*ncell[1] + cell_i[1])*ncell[2] + cell_i[2];
+			cell_next[i] = cell_head[cell[i]];
+			cell_head[cell[i]] = i;
+		}
+	}
+
+	start.resize(n+1);
+	neighbor.clear();
+	for ( int i=0; i<n; i++ ) {
+		start[i] = neighbor.size();
+		if ( use_cells ) {
+			cell_i[0] = cell[i]/(ncell[1]*ncell[2]);
+			cell_i[1] = (cell[i]/ncell[2]) % ncell[1];
+			cell_i[2] = cell[i] % ncell[2];
+			for ( int o=0; o<27; o++ ) {
+				cell_j[0] = (cell_i[0] + o/9 - 1 + ncell[0]) % ncell[0];
+				cell_j[1] = (cell_i[1] + (o/3)%3 - 1 + ncell[1]) % ncell[1];
+				cell_j[2] = (cell_i[2] + o%3 - 1 + ncell[2]) % ncell[2];
+				for ( int j = cell_head[(cell_j[0]*ncell[1] + cell_j[1])*ncell[2] + cell_j[2]]; j != -1; j = cell_next[j] ) {
+					if ( j <= i ) continue;
+					nb.r = at_separation(pbc,site[i].pos,site[j].pos,nb.d);
+					if ( nb.r >= cutoff ) continue;
+					nb.j = j;
+					neighbor.push_back(nb);
 				}
 			}
 		}
+		else {
+			for ( int j=i+1; j<n; j++ ) {
+				nb.r = at_separation(pbc,site[i].pos,site[j].pos,nb.d);
+				if ( ( cutoff > 0 ) && ( nb.r >= cutoff ) ) continue;
+				nb.j = j;
+				neighbor.push_back(nb);
+			}
+		}
 	}
-	// We're counting each pair 6 times
-	potential = potential/6;
+	start[n] = neighbor.size();
+}
+
+// energy of the triples i < j < k with i < nfirst whose three pairs are within the cutoff
+// and whose atoms are not all in one molecule; every triple is counted once
+static double at_triples ( system_t *system, std::vector<at_site> &site, int nfirst ) {
+	int n = site.size();
+	double potential = 0.0;
+	std::vector<int> start, mark(n,-1), slot(n);
+	std::vector<at_neighbor> neighbor;
+
+	at_pair_lists(system,site,system->axilrod_teller_cutoff,start,neighbor);
+
+	for ( int i=0; i<nfirst; i++ ) {
+		for ( int a=start[i]; a<start[i+1]; a++ ) {
+			int j = neighbor[a].j;
+
+			// the partners of j, so that j-k can be looked up rather than recomputed
+			for ( int b=start[j]; b<start[j+1]; b++ ) {
+				mark[neighbor[b].j] = j;
+				slot[neighbor[b].j] = b;
+			}
+
+			for ( int c=start[i]; c<start[i+1]; c++ ) {
+				int k = neighbor[c].j;
+				if ( ( k <= j ) || ( mark[k] != j ) ) continue;
+				if ( ( site[i].molecule == site[j].molecule ) && ( site[i].molecule == site[k].molecule ) ) continue;
+
+				at_neighbor &ij = neighbor[a], &ik = neighbor[c], &jk = neighbor[slot[k]];
+
+				// Mixing rule, ep. 20 of http://dx.doi.org/10.1063/1.440310
+				double c9 = site[i].s*site[j].s*site[k].s * 3.0/(site[i].t+site[j].t+site[k].t);
+				c9 *= 0.0032539449/(3.166811429*0.000001); // convert H*Bohr^9 to K*Angstrom^9
+
+				// the cosines of the angles at i, j and k
+				double cos_part = 3.0;
+				cos_part *= ij.d.dot(ik.d) / ( ij.r * ik.r );
+				cos_part *= -ij.d.dot(jk.d) / ( ij.r * jk.r );
+				cos_part *= ik.d.dot(jk.d) / ( ik.r * jk.r );
+
+				potential += c9*((1.0+cos_part)/pow(ij.r*ik.r*jk.r,3));
+			}
+		}
+	}
+
 	return potential;
 }
+
+double axilrod_teller ( system_t *system ) {
+	std::vector<at_site> site;
+	at_site s;
+	molecule_t *molecule_ptr;
+	atom_t *atom_ptr;
+	int m = 0;
+
+	for ( molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next, m++ )
+		for ( atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next )
+			if ( at_make_site(system,atom_ptr,m,&s) ) site.push_back(s);
+
+	return at_triples(system,site,site.size());
+}
+
+// three-body energy of the triples that involve molecule, with the rest of the system (less skip)
+double axilrod_teller_molecule ( system_t *system, molecule_t *molecule, molecule_t *skip ) {
+	std::vector<at_site> site;
+	at_site s;
+	molecule_t *molecule_ptr;
+	atom_t *atom_ptr;
+	Vec d;
+	double cutoff = system->axilrod_teller_cutoff;
+	int m = 1, nfirst;
+
+	// the molecule's own sites go first, as molecule 0
+	for ( atom_ptr = molecule->atoms; atom_ptr; atom_ptr = atom_ptr->next )
+		if ( at_make_site(system,atom_ptr,0,&s) ) site.push_back(s);
+	nfirst = site.size();
+	if ( !nfirst ) return 0.0;
+
+	// then the sites that are within the cutoff of any of them
+	for ( molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next, m++ ) {
+		if ( ( molecule_ptr == molecule ) || ( molecule_ptr == skip ) ) continue;
+		for ( atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next ) {
+			if ( !at_make_site(system,atom_ptr,m,&s) ) continue;
+			int near = ( cutoff <= 0 );
+			for ( int i=0; ( i<nfirst ) && !near; i++ )
+				near = ( at_separation(system->pbc,site[i].pos,s.pos,d) < cutoff );
+			if ( near ) site.push_back(s);
+		}
+	}
+
+	return at_triples(system,site,nfirst);
+}
@@ -29,7 +29,10 @@ double coulombic(system_t *system) {
 		potential = coulombic_wolf(system);
 	else {
 		real = coulombic_real(system);
-		reciprocal = coulombic_reciprocal(system);
+		if(system->ewald_spme)
+			reciprocal = coulombic_reciprocal_spme(system);
+		else
+			reciprocal = coulombic_reciprocal(system);
 		self = coulombic_self(system);
 
 		/* return the total electrostatic energy */
@@ -39,23 +42,44 @@ double coulombic(system_t *system) {
 	return(potential);
 }
 
-/* fourier space sum */
-double coulombic_reciprocal(system_t *system) {
+/* set up the k-vectors and their prefactors, these only change with the volume (or alpha) */
+static ewald_sf_t *ewald_sf_setup(system_t *system) {
 
-	molecule_t *molecule_ptr;
-	atom_t *atom_ptr;
-	int p, q, kmax, l[3];
-	double alpha;
-	double k[3], k_squared, position_product; //, gaussian (unused variable)
-	double SF_re, SF_im; /* structure factor */
-	// double multiplier; //geometric multiplier (unused variable)
-	double potential = 0;
+	ewald_sf_t *sf = system->ewald_sf;
+	int n, p, q, kmax, l[3];
+	double alpha, k_squared;
 
 	alpha = system->ewald_alpha;
 	kmax = system->ewald_kmax;
 
-	// perform the fourier sum over a hemisphere (skipping certain points to avoid overcounting the face) 
-	for(l[0] = 0; l[0] <= kmax; l[0]++) {
+	if(!sf) {
+		sf = calloc(1, sizeof(ewald_sf_t));
+		memnullcheck(sf, sizeof(ewald_sf_t), __LINE__-1, __FILE__);
+		system->ewald_sf = sf;
+
+		// count the hemisphere (skipping certain points to avoid overcounting the face)
+		for(l[0] = 0; l[0] <= kmax; l[0]++)
+			for(l[1] = (!l[0] ? 0 : -kmax); l[1] <= kmax; l[1]++)
+				for(l[2] = ((!l[0] && !l[1]) ? 1 : -kmax); l[2] <= kmax; l[2]++)
+					if(iidotprod(l,l) <= kmax*kmax) sf->nk++;
+
+		sf->k = calloc(3*sf->nk, sizeof(double));
+		memnullcheck(sf->k, 3*sf->nk*sizeof(double), __LINE__-1, __FILE__);
+		sf->kfactor = calloc(sf->nk, sizeof(double));
+		memnullcheck(sf->kfactor, sf->nk*sizeof(double), __LINE__-1, __FILE__);
+		sf->re = calloc(sf->nk, sizeof(double));
+		memnullcheck(sf->re, sf->nk*sizeof(double), __LINE__-1, __FILE__);
+		sf->im = calloc(sf->nk, sizeof(double));
+		memnullcheck(sf->im, sf->nk*sizeof(double), __LINE__-1, __FILE__);
+		sf->acc_re = calloc(sf->nk, sizeof(double));
+		memnullcheck(sf->acc_re, sf->nk*sizeof(double), __LINE__-1, __FILE__);
+		sf->acc_im = calloc(sf->nk, sizeof(double));
+		memnullcheck(sf->acc_im, sf->nk*sizeof(double), __LINE__-1, __FILE__);
+	}
+
+	if((sf->volume == system->pbc->volume) && (sf->alpha == alpha)) return sf;
+
+	for(l[0] = 0, n = 0; l[0] <= kmax; l[0]++) {
 		for(l[1] = (!l[0] ? 0 : -kmax); l[1] <= kmax; l[1]++) {
 			for(l[2] = ((!l[0] && !l[1]) ? 1 : -kmax); l[2] <= kmax; l[2]++) {
 
@@ -64,39 +88,189 @@ double coulombic_reciprocal(system_t *system) {
 
 				/* get the reciprocal lattice vectors */
 				for(p = 0; p < 3; p++) {
-					for(q = 0, k[p] = 0; q < 3; q++)
-						k[p] += 2.0*M_PI*system->pbc->reciprocal_basis[p][q]*l[q];
+					for(q = 0, sf->k[3*n+p] = 0; q < 3; q++)
+						sf->k[3*n+p] += 2.0*M_PI*system->pbc->reciprocal_basis[p][q]*l[q];
 				}
-				k_squared = dddotprod(k,k);
+				k_squared = dddotprod(&(sf->k[3*n]),&(sf->k[3*n]));
+				sf->kfactor[n] = exp(-k_squared/(4.0*alpha*alpha))/k_squared;
+				n++;
+			}
+		}
+	}
 
-				/* structure factor */
-				SF_re = 0; SF_im = 0;
-				for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next) {
-					for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
+	sf->volume = system->pbc->volume;
+	sf->alpha = alpha;
 
-						if(atom_ptr->frozen) continue; //skip frozen
-						if(atom_ptr->charge == 0.0) continue; //skip if no charge
+	return sf;
+}
 
-						/* the inner product of the position vector and the k vector */
-						position_product = dddotprod(k, atom_ptr->pos);
+/* accumulate the structure factor of a single molecule */
+static void coulombic_molecule_sf(molecule_t *molecule_ptr, double *k, double sign, double *SF_re, double *SF_im) {
 
-						SF_re += atom_ptr->charge*cos(position_product);
-						SF_im += atom_ptr->charge*sin(position_product);
+	atom_t *atom_ptr;
+	double position_product;
 
-					} /* atom */
-				} /* molecule */
+	for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
 
-				potential += exp(-k_squared/(4.0*alpha*alpha))/k_squared*(SF_re*SF_re + SF_im*SF_im);
+		if(atom_ptr->frozen) continue; //skip frozen
+		if(atom_ptr->charge == 0.0) continue; //skip if no charge
 
-			} /* end for n */
-		} /* end for m */
-	} /* end for l */
+		/* the inner product of the position vector and the k vector */
+		position_product = dddotprod(k, atom_ptr->pos);
+		*SF_re += sign*atom_ptr->charge*cos(position_product);
+		*SF_im += sign*atom_ptr->charge*sin(position_product);
+	}
+
+	return;
+}
+
+/* can the structure factors be found from the checkpointed ones and the moved molecule alone? */
+static int ewald_sf_moved(system_t *system, molecule_t **added, molecule_t **removed) {
+
+	checkpoint_t *checkpoint = system->checkpoint;
+
+	if(!(system->ewald_incremental && system->ewald_sf && system->ewald_sf->acc_valid && checkpoint->move_pending)) return 0;
+
+	/* bound the round-off drift with a full sum every so often */
+	if(!(system->step % system->ewald_incremental_refresh)) return 0;
+
+	switch(checkpoint->movetype) {
+		case MOVETYPE_INSERT :
+			*added = checkpoint->molecule_altered;
+			*removed = NULL;
+			return 1;
+		case MOVETYPE_REMOVE :
+			*added = NULL;
+			*removed = checkpoint->molecule_backup;
+			return 1;
+		case MOVETYPE_DISPLACE :
+		case MOVETYPE_ADIABATIC :
+			*added = checkpoint->molecule_altered;
+			*removed = checkpoint->molecule_backup;
+			return 1;
+		default :
+			return 0;
+	}
+}
+
+/* store the structure factors of the current configuration */
+static void ewald_sf_update(system_t *system, ewald_sf_t *sf) {
+
+	molecule_t *molecule_ptr, *added = NULL, *removed = NULL;
+	int n;
+
+	if(ewald_sf_moved(system, &added, &removed)) {
+		for(n = 0; n < sf->nk; n++) {
+			sf->re[n] = sf->acc_re[n];
+			sf->im[n] = sf->acc_im[n];
+			if(added) coulombic_molecule_sf(added, &(sf->k[3*n]), 1.0, &(sf->re[n]), &(sf->im[n]));
+			if(removed) coulombic_molecule_sf(removed, &(sf->k[3*n]), -1.0, &(sf->re[n]), &(sf->im[n]));
+		}
+	} else {
+		for(n = 0; n < sf->nk; n++) {
+			sf->re[n] = 0; sf->im[n] = 0;
+			for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next)
+				coulombic_molecule_sf(molecule_ptr, &(sf->k[3*n]), 1.0, &(sf->re[n]), &(sf->im[n]));
+		}
+	}
+	sf->valid = 1;
+
+	return;
+}
+
+/* fourier space sum */
+double coulombic_reciprocal(system_t *system) {
+
+	ewald_sf_t *sf;
+	int n;
+	double potential = 0;
+
+	sf = ewald_sf_setup(system);
+	ewald_sf_update(system, sf);
+
+	for(n = 0; n < sf->nk; n++)
+		potential += sf->kfactor[n]*(sf->re[n]*sf->re[n] + sf->im[n]*sf->im[n]);
 
 	potential *= 4.0*M_PI/system->pbc->volume;
 
 	return(potential);
 }
 
+/* change in the fourier space sum when the molecule "removed" is replaced by "added" */
+/* (either may be NULL), the current system must already contain "added" and not "removed" */
+double coulombic_reciprocal_delta(system_t *system, molecule_t *added, molecule_t *removed) {
+
+	ewald_sf_t *sf;
+	int n;
+	double dSF_re, dSF_im;
+	double potential = 0;
+
+	if(system->ewald_spme)
+		return(coulombic_reciprocal_spme_delta(system));
+
+	sf = ewald_sf_setup(system);
+	ewald_sf_update(system, sf);
+
+	for(n = 0; n < sf->nk; n++) {
+
+		/* structure factor change due to the move */
+		dSF_re = 0; dSF_im = 0;
+		if(added) coulombic_molecule_sf(added, &(sf->k[3*n]), 1.0, &dSF_re, &dSF_im);
+		if(removed) coulombic_molecule_sf(removed, &(sf->k[3*n]), -1.0, &dSF_re, &dSF_im);
+
+		/* |S|^2 - |S - dS|^2 */
+		potential += sf->kfactor[n]*(2.0*(sf->re[n]*dSF_re + sf->im[n]*dSF_im) - dSF_re*dSF_re - dSF_im*dSF_im);
+	}
+
+	potential *= 4.0*M_PI/system->pbc->volume;
+
+	return(potential);
+}
+
+/* the checkpointed configuration is the one last evaluated */
+void ewald_sf_checkpoint(system_t *system) {
+
+	ewald_sf_t *sf = system->ewald_sf;
+
+	if(!sf) return;
+
+	memcpy(sf->acc_re, sf->re, sf->nk*sizeof(double));
+	memcpy(sf->acc_im, sf->im, sf->nk*sizeof(double));
+	sf->acc_valid = sf->valid;
+
+	return;
+}
+
+/* roll back to the checkpointed structure factors */
+void ewald_sf_restore(system_t *system) {
+
+	ewald_sf_t *sf = system->ewald_sf;
+
+	if(!sf) return;
+
+	memcpy(sf->re, sf->acc_re, sf->nk*sizeof(double));
+	memcpy(sf->im, sf->acc_im, sf->nk*sizeof(double));
+	sf->valid = sf->acc_valid;
+
+	return;
+}
+
+void free_ewald_sf(system_t *system) {
+
+	ewald_sf_t *sf = system->ewald_sf;
+
+	free(sf->k);
+	free(sf->kfactor);
+	free(sf->re);
+	free(sf->im);
+	free(sf->acc_re);
+	free(sf->acc_im);
+	free(sf);
+	system->ewald_sf = NULL;
+
+	return;
+}
+
 double coulombic_self(system_t *system) {
 
 	molecule_t * molecule_ptr;
@@ -143,7 +317,7 @@ double coulombic_real_FH(molecule_t * molecule_ptr, pair_t * pair_ptr, double ga
 	if(order >= 4) {
 
 		d3u = (gaussian_term/sqrt(M_PI))*(-8.0*(a3*a2)*r - 8.0*(a3)/r - 12.0*alpha*ir3) 
-			- 6.0*erfc(alpha*r)*ir4;
+			- 6.0*erfc_term*ir4;
 		d4u = (gaussian_term/sqrt(M_PI))*( 8.0*a3*a2 + 16.0*a3*a4*rr + 32.0*a3
 			*ir2 + 48.0*ir4 ) + 24.0*erfc_term*(ir4*ir);
 
@@ -163,13 +337,16 @@ double coulombic_real(system_t *system) {
 	pair_t *pair_ptr;
 	double alpha, r, erfc_term, gaussian_term;
 	double potential, potential_classical;
+	ewald_table_t *table = NULL;
 
 	alpha = system->ewald_alpha;
+	if(system->ewald_table)
+		table = system->ewald_table_data = ewald_table_setup(system, system->ewald_table_data, alpha, system->pbc->cutoff);
 
 	potential = 0;
 	for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next) {
 		for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
-			for(pair_ptr = atom_ptr->pairs; pair_ptr; pair_ptr = pair_ptr->next) {
+			for(pair_ptr = PAIR_HEAD(system,atom_ptr); pair_ptr; pair_ptr = PAIR_NEXT(system,pair_ptr)) {
 
 				if(pair_ptr->recalculate_energy) {
 					pair_ptr->es_real_energy = 0;
@@ -180,8 +357,7 @@ double coulombic_real(system_t *system) {
 						if(!((r > system->pbc->cutoff) || pair_ptr->es_excluded)) {	/* unit cell part */
 
 							//calculate potential contribution
-							erfc_term = erfc(alpha*r);
-							gaussian_term = exp(-alpha*alpha*r*r);
+							ewald_table_eval(table, alpha, r, &erfc_term, &gaussian_term);
 							potential_classical = atom_ptr->charge*pair_ptr->atom->charge*erfc_term/r;
 							//store for pair pointer, so we don't always have to recalculate
 							pair_ptr->es_real_energy += potential_classical;
@@ -189,8 +365,10 @@ double coulombic_real(system_t *system) {
 							if(system->feynman_hibbs)
 								pair_ptr->es_real_energy += coulombic_real_FH(molecule_ptr,pair_ptr,gaussian_term,erfc_term,system);		
 
-						} else if(pair_ptr->es_excluded) /* calculate the charge-to-screen interaction */
-							pair_ptr->es_self_intra_energy = atom_ptr->charge*pair_ptr->atom->charge*erf(alpha*pair_ptr->r)/pair_ptr->r;
+						} else if(pair_ptr->es_excluded) { /* calculate the charge-to-screen interaction */
+							if(table) ewald_table_eval(table, alpha, pair_ptr->r, &erfc_term, NULL);
+							pair_ptr->es_self_intra_energy = atom_ptr->charge*pair_ptr->atom->charge*(table ? 1.0 - erfc_term : erf(alpha*pair_ptr->r))/pair_ptr->r;
+						}
 
 					} /* frozen */
 
@@ -203,6 +381,10 @@ double coulombic_real(system_t *system) {
 		} /* atom */
 	} /* molecule */
 
+	/* sorbate-framework interactions */
+	if(system->framework_grid)
+		potential += framework_grid_es(system);
+
 	return(potential);
 
 }
@@ -246,6 +428,10 @@ double coulombic_wolf(system_t * system ) {
 	double secondterm = erfcaRoverR/cutoff + 2*alpha/sqrt(M_PI)*exp(-alpha*alpha*cutoff*cutoff)/cutoff;
 	
 	double r;
+	ewald_table_t *table = NULL;
+
+	if(system->ewald_table)
+		table = system->ewald_table_data = ewald_table_setup(system, system->ewald_table_data, alpha, cutoff);
 
 	for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next) {
 		for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
@@ -256,17 +442,19 @@ double coulombic_wolf(system_t * system ) {
 
 					r = pair_ptr->rimg;
 					if( (!pair_ptr->frozen) && (!pair_ptr->es_excluded) && (r < cutoff) ) {
-						erfc_term = erfc(alpha*r)/r;
+						ewald_table_eval(table, alpha, r, &erfc_term, &gaussian_term);
+						erfc_term /= r;
 						pair_ptr->es_real_energy = atom_ptr->charge * 
 							pair_ptr->atom->charge * ( erfc_term - erfcaRoverR );
 						// get feynman-hibbs contribution
 						if(system->feynman_hibbs) {
-							gaussian_term = exp(-alpha*alpha*r*r);
 							pair_ptr->es_real_energy += coulombic_real_FH(molecule_ptr,pair_ptr,gaussian_term,erfc_term,system);
 						} // FH
 					}  // r<cutoff
-					else if ( pair_ptr->es_excluded )
-						pair_ptr->es_self_intra_energy = atom_ptr->charge*pair_ptr->atom->charge*erf(alpha*r)/r;
+					else if ( pair_ptr->es_excluded ) {
+						ewald_table_eval(table, alpha, r, &erfc_term, NULL);
+						pair_ptr->es_self_intra_energy = atom_ptr->charge*pair_ptr->atom->charge*(1.0 - erfc_term)/r;
+					}
 
 				} //recalculate
 				pot += -pair_ptr->es_self_intra_energy + pair_ptr->es_real_energy;
@@ -282,6 +470,8 @@ double coulombic_wolf(system_t * system ) {
 }
 */
 
+/* shifted-force wolf sum: erf(alpha R) is taken once at the cutoff, so the pairs need no erfc/exp */
+/* (the damped form above goes through the ewald table like coulombic_real()) */
 double coulombic_wolf ( system_t * system ) {
 
 	molecule_t *mptr;
@@ -297,7 +487,7 @@ double coulombic_wolf ( system_t * system ) {
 
 	for(mptr = system->molecules; mptr; mptr = mptr->next) {
 		for(aptr = mptr->atoms; aptr; aptr = aptr->next) {
-			for(pptr = aptr->pairs; pptr; pptr = pptr->next) {
+			for(pptr = PAIR_HEAD(system,aptr); pptr; pptr = PAIR_NEXT(system,pptr)) {
 
 				if ( pptr->recalculate_energy ) {
 					pptr->es_real_energy = 0;
@@ -2,6 +2,168 @@
 
 //Copyright 2013-2015 Adam Hogan
 
+/* mixing rules for a pair of atom types with parameters pi and pj */
+static void disp_expansion_mix_params(const system_t *system, const disp_mix_t *pi, const disp_mix_t *pj, disp_mix_t *mix)
+{
+	// forumlas for these (except JR Schmidt's mixing rule) is here http://pubs.acs.org/doi/pdf/10.1021/acs.jpca.6b10295
+	if (system->schmidt_mixing)
+	{
+		mix->sigma = 0.5*(pi->sigma + pj->sigma);
+		mix->epsilon = (pi->epsilon+pj->epsilon)*pi->epsilon*pj->epsilon/(pi->epsilon*pi->epsilon+pj->epsilon*pj->epsilon);
+	}
+	else if (system->gilbert_smith_mixing)
+	{
+		double c = 315.7750382111558307123944638; // don't confuse this for C, which is #defined as the speed of light
+		double Aii = c * exp(pi->epsilon*pi->sigma);
+		double Ajj = c * exp(pj->epsilon*pj->sigma);
+		double Bii = pi->epsilon;
+		double Bjj = pj->epsilon;
+		mix->epsilon = 2.0*pi->epsilon*pj->epsilon/(pi->epsilon + pj->epsilon);
+		double Bij = mix->epsilon;
+		double Aij = pow(pow(Aii*Bii,1.0/Bii)*pow(Ajj*Bjj,1.0/Bjj),0.5*Bij)/Bij;
+		mix->sigma = log(Aij/c)/Bij;
+	}
+	else if (system->bohm_ahlrichs_mixing)
+	{
+		double c = 315.7750382111558307123944638;
+		double Aii = c * exp(pi->epsilon*pi->sigma);
+		double Ajj = c * exp(pj->epsilon*pj->sigma);
+		double Bii = pi->epsilon;
+		double Bjj = pj->epsilon;
+		mix->epsilon = 2.0*pi->epsilon*pj->epsilon/(pi->epsilon + pj->epsilon);
+		double Bij = mix->epsilon;
+		double Aij = pow(pow(Aii,1.0/Bii)*pow(Ajj,1.0/Bjj),0.5*Bij);
+		mix->sigma = log(Aij/c)/Bij;
+	}
+	else if (system->wilson_popelier_mixing)
+	{
+		double c = 315.7750382111558307123944638;
+		double Aii = c * exp(pi->epsilon*pi->sigma);
+		double Ajj = c * exp(pj->epsilon*pj->sigma);
+		double Bii = pi->epsilon;
+		double Bjj = pj->epsilon;
+		mix->epsilon = sqrt(0.5*(Bii*Bii+Bjj*Bjj));
+		double Aij = pow(0.5*(pow(Aii,0.4)+pow(Ajj,0.4)),1.0/0.4);
+		mix->sigma = log(Aij/c)/mix->epsilon;
+	}
+	else
+	{
+		mix->sigma = 0.5*(pi->sigma + pj->sigma);
+		mix->epsilon = 2.0*pi->epsilon*pj->epsilon/(pi->epsilon + pj->epsilon);
+	}
+
+	/* get mixed dispersion coefficients */
+	mix->c6 = sqrt(pi->c6*pj->c6)*0.021958709/(3.166811429*0.000001); // Convert H*Bohr^6 to K*Angstrom^6, etc
+	mix->c8 = sqrt(pi->c8*pj->c8)*0.0061490647/(3.166811429*0.000001); // Dispersion coeffs should be inputed in a.u.
+
+	if (system->extrapolate_disp_coeffs&&mix->c6!=0.0&&mix->c8!=0.0)
+		mix->c10 = 49.0/40.0*mix->c8*mix->c8/mix->c6;
+	else if (system->extrapolate_disp_coeffs)
+		mix->c10 = 0.0; //either c6 or c8 is zero so lets set c10 to zero too
+	else
+		mix->c10 = sqrt(pi->c10*pj->c10)*0.0017219135/(3.166811429*0.000001);
+}
+
+static void disp_expansion_params(const atom_t *atom, disp_mix_t *p)
+{
+	p->epsilon = atom->epsilon;
+	p->sigma = atom->sigma;
+	p->c6 = atom->c6;
+	p->c8 = atom->c8;
+	p->c10 = atom->c10;
+}
+
+static int disp_expansion_same(const disp_mix_t *p, const disp_mix_t *q)
+{
+	return p->epsilon == q->epsilon && p->sigma == q->sigma && p->c6 == q->c6 && p->c8 == q->c8 && p->c10 == q->c10;
+}
+
+/* mix the coefficients of atom_i and atom_j directly */
+void disp_expansion_mix_atoms(const system_t *system, const atom_t *atom_i, const atom_t *atom_j, disp_mix_t *mix)
+{
+	disp_mix_t pi, pj;
+
+	disp_expansion_params(atom_i, &pi);
+	disp_expansion_params(atom_j, &pj);
+	disp_expansion_mix_params(system, &pi, &pj, mix);
+}
+
+/* the type of an atom; parameters that haven't been seen before make a new type, mixed with all the others */
+static int disp_expansion_type(system_t *system, atom_t *atom)
+{
+	disp_types_t *dt = system->disp_types;
+	disp_mix_t p, *mix;
+	int t = atom->disp_type - 1, a, b, size;
+
+	disp_expansion_params(atom, &p);
+
+	/* the type it had still fits */
+	if ( (t >= 0) && (t < dt->n) && disp_expansion_same(&dt->param[t], &p) ) return t;
+
+	for ( t=0; t<dt->n; t++ )
+		if ( disp_expansion_same(&dt->param[t], &p) ) break;
+
+	if ( t == dt->n ) {
+		if ( dt->n == dt->size ) {
+			size = dt->size ? 2*dt->size : DISP_TYPES_START;
+			dt->param = realloc(dt->param, size*sizeof(disp_mix_t));
+			memnullcheck(dt->param, size*sizeof(disp_mix_t), __LINE__-1, __FILE__);
+			mix = calloc(size*size, sizeof(disp_mix_t));
+			memnullcheck(mix, size*size*sizeof(disp_mix_t), __LINE__-1, __FILE__);
+			for ( a=0; a<dt->n; a++ )
+				for ( b=0; b<dt->n; b++ )
+					mix[a*size+b] = dt->mix[a*dt->size+b];
+			free(dt->mix);
+			dt->mix = mix;
+			dt->size = size;
+		}
+
+		dt->param[t] = p;
+		dt->n++;
+		/* in both orders, the mixing rules aren't bitwise symmetric */
+		for ( a=0; a<dt->n; a++ ) {
+			disp_expansion_mix_params(system, &dt->param[t], &dt->param[a], &dt->mix[t*dt->size+a]);
+			disp_expansion_mix_params(system, &dt->param[a], &dt->param[t], &dt->mix[a*dt->size+t]);
+		}
+	}
+
+	atom->disp_type = t + 1;
+	return t;
+}
+
+/* the mixed coefficients of a pair of atoms, from the table of atom types */
+const disp_mix_t *disp_expansion_mix(system_t *system, atom_t *atom_i, atom_t *atom_j)
+{
+	int ti, tj;
+
+	if ( !system->disp_types ) {
+		system->disp_types = calloc(1, sizeof(disp_types_t));
+		memnullcheck(system->disp_types, sizeof(disp_types_t), __LINE__-1, __FILE__);
+	}
+
+	ti = disp_expansion_type(system, atom_i);
+	tj = disp_expansion_type(system, atom_j);
+
+	return &system->disp_types->mix[ti*system->disp_types->size+tj];
+}
+
+void free_disp_types(disp_types_t *dt)
+{
+	if ( !dt ) return;
+	free(dt->param);
+	free(dt->mix);
+	free(dt);
+}
+
+/* -4 pi (c6/3rc^3 + c8/5rc^5 + c10/7rc^7) / V */
+static double disp_expansion_lrc_sum(const system_t *system, const double c6, const double c8, const double c10, const double cutoff)
+{
+	const double rc2 = 1.0/(cutoff*cutoff);
+	const double rc3 = rc2/cutoff;
+
+	return -4.0*M_PI*rc3*(c6/3.0+rc2*(c8/5.0+rc2*c10/7.0))/system->pbc->volume;
+}
+
 double disp_expansion_lrc( const system_t * system,  pair_t * pair_ptr, const double cutoff ) /* ignoring the exponential repulsion bit because it decays exponentially */
 {
 	if( !( pair_ptr->frozen ) &&  /* disqualify frozen pairs */
@@ -9,7 +171,7 @@ double disp_expansion_lrc( const system_t * system,  pair_t * pair_ptr, const do
 
 		pair_ptr->last_volume = system->pbc->volume;
 
-		return -4.0*M_PI*(pair_ptr->c6/(3.0*cutoff*cutoff*cutoff)+pair_ptr->c8/(5.0*cutoff*cutoff*cutoff*cutoff*cutoff)+pair_ptr->c10/(7.0*cutoff*cutoff*cutoff*cutoff*cutoff*cutoff*cutoff))/system->pbc->volume;
+		return disp_expansion_lrc_sum(system,pair_ptr->c6,pair_ptr->c8,pair_ptr->c10,cutoff);
 	}
 
 	else return pair_ptr->lrc; /* use stored value */
@@ -30,10 +192,10 @@ double disp_expansion_lrc_self( const system_t * system, atom_t * atom_ptr, cons
 			else
 				c10 = 0.0;
 
-			return -4.0*M_PI*(atom_ptr->c6/(3.0*cutoff*cutoff*cutoff)+atom_ptr->c8/(5.0*cutoff*cutoff*cutoff*cutoff*cutoff)+c10/(7.0*cutoff*cutoff*cutoff*cutoff*cutoff*cutoff*cutoff))/system->pbc->volume;
+			return disp_expansion_lrc_sum(system,atom_ptr->c6,atom_ptr->c8,c10,cutoff);
 		}
 		else
-			return -4.0*M_PI*(atom_ptr->c6/(3.0*cutoff*cutoff*cutoff)+atom_ptr->c8/(5.0*cutoff*cutoff*cutoff*cutoff*cutoff)+atom_ptr->c10/(7.0*cutoff*cutoff*cutoff*cutoff*cutoff*cutoff*cutoff))/system->pbc->volume;
+			return disp_expansion_lrc_sum(system,atom_ptr->c6,atom_ptr->c8,atom_ptr->c10,cutoff);
 	}
 
 	return atom_ptr->lrc_self; /* use stored value */
@@ -78,8 +240,11 @@ double disp_expansion(system_t *system)
 						if (pair_ptr->epsilon!=0.0&&pair_ptr->sigma!=0.0)
 							repulsion = 315.7750382111558307123944638 * exp(-pair_ptr->epsilon*(r-pair_ptr->sigma)); // K = 10^-3 H ~= 316 K
 
-						if (system->damp_dispersion)
-							pair_ptr->rd_energy = -tt_damping(6,pair_ptr->epsilon*r)*c6/r6-tt_damping(8,pair_ptr->epsilon*r)*c8/r8-tt_damping(10,pair_ptr->epsilon*r)*c10/r10+repulsion;
+						if (system->damp_dispersion) {
+							double f6, f8, f10;
+							tt_damping_6_8_10(pair_ptr->epsilon*r,&f6,&f8,&f10);
+							pair_ptr->rd_energy = -f6*c6/r6-f8*c8/r8-f10*c10/r10+repulsion;
+						}
 						else
 							pair_ptr->rd_energy = -c6/r6-c8/r8-c10/r10+repulsion;
 
@@ -154,8 +319,11 @@ double disp_expansion_nopbc(system_t *system)
 						if (pair_ptr->epsilon!=0.0&&pair_ptr->sigma!=0.0)
 							repulsion = 315.7750382111558307123944638 * exp(-pair_ptr->epsilon*(r-pair_ptr->sigma)); // K = 10^-3 H ~= 316 K
 
-						if (system->damp_dispersion)
-							pair_ptr->rd_energy = -tt_damping(6,pair_ptr->epsilon*r)*c6/r6-tt_damping(8,pair_ptr->epsilon*r)*c8/r8-tt_damping(10,pair_ptr->epsilon*r)*c10/r10+repulsion;
+						if (system->damp_dispersion) {
+							double f6, f8, f10;
+							tt_damping_6_8_10(pair_ptr->epsilon*r,&f6,&f8,&f10);
+							pair_ptr->rd_energy = -f6*c6/r6-f8*c8/r8-f10*c10/r10+repulsion;
+						}
 						else
 							pair_ptr->rd_energy = -c6/r6-c8/r8-c10/r10+repulsion;
 
@@ -192,13 +360,15 @@ double factorial(int n)
 	return fac;
 }
 
+/* 1 - exp(-br) sum_{i<=n} br^i/i!, with the terms of the sum built up one from the last */
 double tt_damping(int n, double br)
 {
-	double sum = 0.0;
+	double sum = 1.0, term = 1.0;
 	int i;
-	for (i=0;i<=n;i++)
+	for (i=1;i<=n;i++)
 	{
-		sum += pow(br,i)/factorial(i);
+		term *= br/i;
+		sum += term;
 	}
 
 	const double result = 1.0-exp(-br)*sum;
@@ -208,3 +378,25 @@ double tt_damping(int n, double br)
 	else
 		return 0.0; /* This is so close to zero lets just call it zero to avoid rounding error and the simulation blowing up */
 }
+
+/* the damping of orders 6, 8 and 10 together, from one exponential and one running sum */
+void tt_damping_6_8_10(double br, double *f6, double *f8, double *f10)
+{
+	const double e = exp(-br);
+	double sum = 1.0, term = 1.0;
+	int i;
+
+	for (i=1;i<=10;i++)
+	{
+		term *= br/i;
+		sum += term;
+		if (i==6) *f6 = 1.0-e*sum;
+		else if (i==8) *f8 = 1.0-e*sum;
+	}
+	*f10 = 1.0-e*sum;
+
+	/* as in tt_damping(), so close to zero lets just call it zero */
+	if (!(*f6>0.000000001)) *f6 = 0.0;
+	if (!(*f8>0.000000001)) *f8 = 0.0;
+	if (!(*f10>0.000000001)) *f10 = 0.0;
+}
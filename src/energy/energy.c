@@ -61,6 +61,29 @@ double cavity_absolute_check ( system_t * system ) {
 	return 0;
 }
 
+/* set the observables that follow from the total potential energy */
+void update_energy_observables(system_t *system, double potential_energy) {
+
+	system->observables->energy = potential_energy;
+
+	countN(system);
+	system->observables->spin_ratio /= system->observables->N;
+
+	/* for NVE */
+	if(system->ensemble == ENSEMBLE_NVE) {
+		system->observables->kinetic_energy = system->total_energy - potential_energy;
+		system->observables->temperature = (2.0/3.0)*system->observables->kinetic_energy/system->observables->N;
+	}
+
+	/* need this for the isosteric heat */
+	system->observables->NU = system->observables->N*system->observables->energy;
+
+	/* set last known volume*/
+	system->last_volume = system->pbc->volume;
+
+	return;
+}
+
 /* returns the total potential energy for the system and updates our observables */
 double energy(system_t *system) {
 
@@ -199,22 +222,7 @@ double energy(system_t *system) {
 	 **/
 	
 	if(system->gwp) potential_energy += kinetic_energy;
-	system->observables->energy = potential_energy;
-
-	countN(system);
-	system->observables->spin_ratio /= system->observables->N;
-
-	/* for NVE */
-	if(system->ensemble == ENSEMBLE_NVE) {
-		system->observables->kinetic_energy = system->total_energy - potential_energy;
-		system->observables->temperature = (2.0/3.0)*system->observables->kinetic_energy/system->observables->N;
-	}
-
-	/* need this for the isosteric heat */
-	system->observables->NU = system->observables->N*system->observables->energy;
-
-	/* set last known volume*/
-	system->last_volume = system->pbc->volume;
+	update_energy_observables(system, potential_energy);
 
 	if(system->cavity_autoreject_absolute)
 		potential_energy += cavity_absolute_check( system );
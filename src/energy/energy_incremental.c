@@ -0,0 +1,230 @@
+/*
+
+Space Research Group
+Department of Chemistry
+University of South Florida
+
+Single-molecule energy differences for displace, insert and remove moves.
+Only the interactions of the molecule that was moved, inserted or removed are
+evaluated; the rest of the system is unchanged, so its contribution is carried
+over from the observables of the last accepted configuration.
+
+*/
+
+#include <mc.h>
+
+/* can the energy of the current move be found from the last accepted energy? */
+int energy_incremental_move(system_t *system) {
+
+	if(!system->incremental_energy) return 0;
+
+	/* need a finite energy to build upon */
+	if(!finite(system->observables->energy) || (system->observables->energy >= MAXVALUE)) return 0;
+
+	switch(system->checkpoint->movetype) {
+		case MOVETYPE_INSERT :
+		case MOVETYPE_REMOVE :
+		case MOVETYPE_DISPLACE :
+		case MOVETYPE_ADIABATIC :
+			return 1;
+		default :
+			return 0;
+	}
+}
+
+/* energy of molecule with every other molecule in the system (skipping "skip"), and if self is set, */
+/* the terms that only exist while the molecule is present: the ewald self terms and the LRC's */
+static void energy_incremental_molecule(system_t *system, molecule_t *molecule, molecule_t *skip, int self, double *rd, double *es, int *overlap) {
+
+	int p;
+	molecule_t *molecule_ptr;
+	atom_t *atom_ptr, *atom_j;
+	pair_t pair;
+	double alpha = system->ewald_alpha;
+	double cutoff = system->pbc->cutoff;
+	double sigma_over_r, sigma_over_r6, term12, term6;
+	double erfc_term, gaussian_term, pair_energy;
+	int es_on = !system->rd_only;
+	ewald_table_t *table = NULL;
+
+	if(es_on && system->ewald_table)
+		table = system->ewald_table_data = ewald_table_setup(system, system->ewald_table_data, alpha, cutoff);
+
+	for(atom_ptr = molecule->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
+
+		/* intermolecular terms */
+		for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next) {
+
+			if((molecule_ptr == molecule) || (molecule_ptr == skip)) continue;
+
+			for(atom_j = molecule_ptr->atoms; atom_j; atom_j = atom_j->next) {
+
+				/* framework interactions are taken from the framework grids */
+				if(system->framework_grid && atom_j->frozen) continue;
+
+				memset(&pair, 0, sizeof(pair_t));
+				pair.atom = atom_j;
+				pair.molecule = molecule_ptr;
+				pair_exclusions(system, molecule, molecule_ptr, atom_ptr, atom_j, &pair);
+				for(p = 0; p < 3; p++)
+					pair.d_prev[p] = NAN; //force minimum_image() to compute the separation
+				minimum_image(system, atom_ptr, atom_j, &pair);
+
+				if(self && system->rd_lrc)
+					*rd += lj_lrc_corr(system, atom_ptr, &pair, cutoff);
+
+				if(pair.frozen) continue;
+
+				if(system->cavity_autoreject_absolute && (pair.rimg < system->cavity_autoreject_scale))
+					*overlap = 1;
+
+				/* repulsion/dispersion, as in lj() */
+				if((pair.rimg - SMALL_dR < cutoff) && !pair.rd_excluded) {
+
+					sigma_over_r = fabs(pair.sigma)/pair.rimg;
+					sigma_over_r6 = sigma_over_r*sigma_over_r*sigma_over_r;
+					sigma_over_r6 *= sigma_over_r6;
+
+					term6 = sigma_over_r6;
+					term12 = pair.attractive_only ? 0 : sigma_over_r6*sigma_over_r6;
+					pair_energy = 4.0*pair.epsilon*(term12 - term6);
+
+					if(system->feynman_hibbs)
+						pair_energy += lj_fh_corr(system, molecule, &pair, system->feynman_hibbs_order, term12, term6);
+
+					if(system->cavity_autoreject)
+						if(pair.rimg < system->cavity_autoreject_scale*fabs(pair.sigma))
+							pair_energy = MAXVALUE;
+
+					*rd += pair_energy;
+				}
+
+				/* real space electrostatics, as in coulombic_real() */
+				if(es_on && !((pair.rimg > cutoff) || pair.es_excluded)) {
+
+					ewald_table_eval(table, alpha, pair.rimg, &erfc_term, &gaussian_term);
+					*es += atom_ptr->charge*atom_j->charge*erfc_term/pair.rimg;
+
+					if(system->feynman_hibbs)
+						*es += coulombic_real_FH(molecule, &pair, gaussian_term, erfc_term, system);
+				}
+
+			} /* atom_j */
+		} /* molecule */
+
+		if(!self) continue;
+
+		/* intramolecular LRC's and charge-to-screen terms */
+		for(atom_j = atom_ptr->next; atom_j; atom_j = atom_j->next) {
+
+			memset(&pair, 0, sizeof(pair_t));
+			pair.atom = atom_j;
+			pair.molecule = molecule;
+			pair_exclusions(system, molecule, molecule, atom_ptr, atom_j, &pair);
+			for(p = 0; p < 3; p++)
+				pair.d_prev[p] = NAN;
+			minimum_image(system, atom_ptr, atom_j, &pair);
+
+			if(system->rd_lrc)
+				*rd += lj_lrc_corr(system, atom_ptr, &pair, cutoff);
+
+			if(es_on && (atom_ptr->charge != 0.0) && (atom_j->charge != 0.0)) {
+				if(table) ewald_table_eval(table, alpha, pair.r, &erfc_term, NULL);
+				*es -= atom_ptr->charge*atom_j->charge*(table ? 1.0 - erfc_term : erf(alpha*pair.r))/pair.r;
+			}
+		}
+
+		/* point self energy, as in coulombic_self() */
+		if(es_on)
+			*es -= alpha*atom_ptr->charge*atom_ptr->charge/sqrt(M_PI);
+
+		if(system->rd_lrc)
+			*rd += lj_lrc_self(system, atom_ptr, cutoff);
+
+	} /* atom */
+
+	if(system->framework_grid) {
+		*rd += framework_grid_molecule_rd(system, molecule);
+		if(es_on) *es += framework_grid_molecule_es(system, molecule);
+	}
+
+	return;
+}
+
+/* returns the total potential energy after the current move and updates our observables */
+double energy_incremental(system_t *system) {
+
+	checkpoint_t *checkpoint = system->checkpoint;
+	double rd_new = 0, es_new = 0, rd_old = 0, es_old = 0, three_new = 0, three_old = 0;
+	double delta_rd, delta_es, delta_three, potential_energy;
+	int overlap = 0, overlap_old = 0;
+
+	switch(checkpoint->movetype) {
+
+		case MOVETYPE_INSERT :
+			energy_incremental_molecule(system, checkpoint->molecule_altered, NULL, 1, &rd_new, &es_new, &overlap);
+			if(!system->rd_only)
+				es_new += coulombic_reciprocal_delta(system, checkpoint->molecule_altered, NULL);
+			if(system->axilrod_teller)
+				three_new = axilrod_teller_molecule(system, checkpoint->molecule_altered, NULL);
+		break;
+		case MOVETYPE_REMOVE :
+			/* the backup is the molecule that was taken out of the list */
+			energy_incremental_molecule(system, checkpoint->molecule_backup, NULL, 1, &rd_old, &es_old, &overlap_old);
+			if(!system->rd_only)
+				es_new += coulombic_reciprocal_delta(system, NULL, checkpoint->molecule_backup);
+			if(system->axilrod_teller)
+				three_old = axilrod_teller_molecule(system, checkpoint->molecule_backup, NULL);
+		break;
+		default : /* displace and adiabatic: the backup holds the old coordinates */
+			energy_incremental_molecule(system, checkpoint->molecule_altered, NULL, 0, &rd_new, &es_new, &overlap);
+			energy_incremental_molecule(system, checkpoint->molecule_backup, checkpoint->molecule_altered, 0, &rd_old, &es_old, &overlap_old);
+			if(!system->rd_only)
+				es_new += coulombic_reciprocal_delta(system, checkpoint->molecule_altered, checkpoint->molecule_backup);
+			if(system->axilrod_teller) {
+				three_new = axilrod_teller_molecule(system, checkpoint->molecule_altered, NULL);
+				three_old = axilrod_teller_molecule(system, checkpoint->molecule_backup, checkpoint->molecule_altered);
+			}
+	}
+
+	delta_rd = rd_new - rd_old;
+	delta_es = es_new - es_old;
+	delta_three = three_new - three_old;
+
+	system->natoms = countNatoms(system);
+
+	/* keep the com's and wrapped coords current, as pairs() does */
+	update_com(system->molecules);
+	wrapall(system->molecules, system->pbc);
+
+	system->observables->rd_energy += delta_rd;
+	if(!system->rd_only) system->observables->coulombic_energy += delta_es;
+	system->observables->three_body_energy += delta_three;
+
+	potential_energy = system->observables->energy + delta_rd + delta_es + delta_three;
+	update_energy_observables(system, potential_energy);
+
+	if(overlap) potential_energy += MAXVALUE;
+
+	return(potential_energy);
+}
+
+/* compare against a full recompute and resync the observables */
+double energy_incremental_check(system_t *system, double incremental_energy) {
+
+	double full_energy, drift;
+	char linebuf[MAXLINE];
+
+	full_energy = energy(system);
+
+	/* a bad contact is rejected either way */
+	if((full_energy >= MAXVALUE) || (incremental_energy >= MAXVALUE)) return(full_energy);
+
+	drift = incremental_energy - full_energy;
+	if(fabs(drift) > INCREMENTAL_ENERGY_TOLERANCE*((fabs(full_energy) > 1.0) ? fabs(full_energy) : 1.0)) {
+		sprintf(linebuf, "MC: incremental energy drifted by %.6e K from the full recompute at step %d, resynchronized\n", drift, system->step);
+		output(linebuf);
+	}
+
+	return(full_energy);
+}
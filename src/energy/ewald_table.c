@@ -0,0 +1,138 @@
+/*
+
+Space Research Group
+Department of Chemistry
+University of South Florida
+
+Tabulated erfc(alpha r) and exp(-alpha^2 r^2) for the real-space ewald (and wolf) kernels.
+The table is keyed on r (the pair code already has rimg, and both functions are smooth
+there down to r = 0) and interpolated with cubic hermite splines; the derivative of erfc
+is the gaussian itself, so both are exact at the nodes. The node spacing is halved until
+the interpolation error, checked between every pair of nodes, is under ewald_table_tolerance.
+
+*/
+
+#include <mc.h>
+#define OneOverSqrtPi 0.5641895835477562869480794515607725858440506293289988
+
+static void ewald_table_nodes(ewald_table_t *table) {
+
+	int i;
+	double r, alpha = table->alpha, g;
+
+	for(i = 0; i < table->n; i++) {
+		r = i*table->h;
+		g = exp(-alpha*alpha*r*r);
+		table->node[4*i] = erfc(alpha*r);
+		table->node[4*i+1] = -2.0*alpha*OneOverSqrtPi*g*table->h;
+		table->node[4*i+2] = g;
+		table->node[4*i+3] = -2.0*alpha*alpha*r*g*table->h;
+	}
+
+	return;
+}
+
+/* largest interpolation error at the quarter and mid points of every interval */
+static double ewald_table_error(ewald_table_t *table) {
+
+	int i, j;
+	double r, e, g, err = 0;
+
+	for(i = 0; i < (table->n - 1); i++) {
+		for(j = 1; j < 4; j++) {
+			r = (i + 0.25*j)*table->h;
+			ewald_table_eval(table, table->alpha, r, &e, &g);
+			if(fabs(e - erfc(table->alpha*r)) > err) err = fabs(e - erfc(table->alpha*r));
+			if(fabs(g - exp(-table->alpha*table->alpha*r*r)) > err) err = fabs(g - exp(-table->alpha*table->alpha*r*r));
+		}
+	}
+
+	return err;
+}
+
+static void ewald_table_build(ewald_table_t *table, double alpha, double rmax, double h) {
+
+	table->alpha = alpha;
+	table->h = h;
+	table->ih = 1.0/h;
+	table->n = (int)ceil(rmax/h) + 2;
+	table->rmax = (table->n - 1)*h;
+
+	free(table->node);
+	table->node = calloc(4*table->n, sizeof(double));
+	memnullcheck(table->node, 4*table->n*sizeof(double), __LINE__-1, __FILE__);
+
+	ewald_table_nodes(table);
+
+	return;
+}
+
+/* returns a table for alpha covering [0,rmax], (re)building it as needed */
+ewald_table_t *ewald_table_setup(system_t *system, ewald_table_t *table, double alpha, double rmax) {
+
+	double h, err;
+	char linebuf[MAXLINE];
+
+	if(table && (table->alpha == alpha) && (table->rmax >= rmax)) return table;
+
+	/* the error goes as (alpha h)^4, so a rebuild for a new alpha (or cutoff) keeps alpha*h */
+	if(table) {
+		ewald_table_build(table, alpha, rmax, table->h*table->alpha/alpha);
+		return table;
+	}
+
+	table = calloc(1, sizeof(ewald_table_t));
+	memnullcheck(table, sizeof(ewald_table_t), __LINE__-1, __FILE__);
+
+	for(h = 0.1/alpha;; h *= 0.5) {
+		ewald_table_build(table, alpha, rmax, h);
+		err = ewald_table_error(table);
+		if((err <= system->ewald_table_tolerance) || (h*alpha < 1.0e-5)) break;
+	}
+
+	sprintf(linebuf, "EWALD_TABLE: alpha = %f, %d nodes at %.3e A to %.3f A, max interpolation error %.3e\n", alpha, table->n, table->h, table->rmax, err);
+	output(linebuf);
+
+	return table;
+}
+
+/* erfc(alpha r) and (if gaussian_term isn't NULL) exp(-alpha^2 r^2), from the table when there is one */
+void ewald_table_eval(ewald_table_t *table, double alpha, double r, double *erfc_term, double *gaussian_term) {
+
+	int i;
+	double t, t2, t3, h00, h10, h01, h11, *node;
+
+	if(!table || (r >= table->rmax)) {
+		*erfc_term = erfc(alpha*r);
+		if(gaussian_term) *gaussian_term = exp(-alpha*alpha*r*r);
+		return;
+	}
+
+	t = r*table->ih;
+	i = (int)t;
+	t -= i;
+	node = &(table->node[4*i]);
+
+	/* cubic hermite basis */
+	t2 = t*t;
+	t3 = t2*t;
+	h00 = 2.0*t3 - 3.0*t2 + 1.0;
+	h10 = t3 - 2.0*t2 + t;
+	h01 = -2.0*t3 + 3.0*t2;
+	h11 = t3 - t2;
+
+	*erfc_term = h00*node[0] + h10*node[1] + h01*node[4] + h11*node[5];
+	if(gaussian_term) *gaussian_term = h00*node[2] + h10*node[3] + h01*node[6] + h11*node[7];
+
+	return;
+}
+
+void free_ewald_table(ewald_table_t *table) {
+
+	if(!table) return;
+
+	free(table->node);
+	free(table);
+
+	return;
+}
@@ -0,0 +1,603 @@
+/*
+
+Space Research Group
+Department of Chemistry
+University of South Florida
+
+Precomputed framework potential grids for a rigid (frozen) host. The sorbate-framework
+repulsion/dispersion (per sigma/epsilon site type) and real-space ewald potential (per
+unit charge) are tabulated on a fractional-coordinate grid at startup and interpolated
+with tricubic (catmull-rom) splines during the simulation. Nodes are capped at
+FRAMEWORK_GRID_EMAX, and next to steep walls the spline is bounded by the corners of
+its cell so that it can't overshoot into artificially low energies.
+
+*/
+
+#include <mc.h>
+
+/* tabulated site types are matched on their LJ parameters */
+static int framework_grid_type(framework_grid_t *fgrid, atom_t *atom_ptr) {
+
+	int t;
+
+	for(t = 0; t < fgrid->ntypes; t++)
+		if((fgrid->sigma[t] == atom_ptr->sigma) && (fgrid->epsilon[t] == atom_ptr->epsilon))
+			return t;
+
+	return -1;
+}
+
+/* add the site types of the non-frozen atoms in a molecule list */
+static void framework_grid_add_types(framework_grid_t *fgrid, molecule_t *molecules) {
+
+	int t;
+	molecule_t *molecule_ptr;
+	atom_t *atom_ptr;
+
+	for(molecule_ptr = molecules; molecule_ptr; molecule_ptr = molecule_ptr->next) {
+		for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
+
+			if(atom_ptr->frozen) continue;
+			if((atom_ptr->sigma == 0.0) || (atom_ptr->epsilon == 0.0)) continue; //no rd interaction
+			if(framework_grid_type(fgrid, atom_ptr) != -1) continue;
+
+			t = fgrid->ntypes++;
+			fgrid->site = realloc(fgrid->site, fgrid->ntypes*sizeof(atom_t));
+			memnullcheck(fgrid->site, fgrid->ntypes*sizeof(atom_t), __LINE__-1, __FILE__);
+			fgrid->sigma = realloc(fgrid->sigma, fgrid->ntypes*sizeof(double));
+			memnullcheck(fgrid->sigma, fgrid->ntypes*sizeof(double), __LINE__-1, __FILE__);
+			fgrid->epsilon = realloc(fgrid->epsilon, fgrid->ntypes*sizeof(double));
+			memnullcheck(fgrid->epsilon, fgrid->ntypes*sizeof(double), __LINE__-1, __FILE__);
+
+			/* keep a copy of the site parameters for mixing */
+			memcpy(&(fgrid->site[t]), atom_ptr, sizeof(atom_t));
+			fgrid->site[t].pairs = NULL;
+			fgrid->site[t].nlist = NULL;
+			fgrid->site[t].next = NULL;
+			fgrid->sigma[t] = atom_ptr->sigma;
+			fgrid->epsilon[t] = atom_ptr->epsilon;
+		}
+	}
+
+	return;
+}
+
+/* collect the frozen atoms and the mixed parameters for each site type */
+static void framework_grid_setup_frame(system_t *system, framework_grid_t *fgrid) {
+
+	int j, t, p;
+	molecule_t *molecule_ptr;
+	atom_t *atom_ptr;
+	pair_t pair;
+
+	for(molecule_ptr = system->molecules, fgrid->nframe = 0; molecule_ptr; molecule_ptr = molecule_ptr->next)
+		for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next)
+			if(atom_ptr->frozen) fgrid->nframe++;
+
+	fgrid->frame_pos = calloc(3*fgrid->nframe + 1, sizeof(double));
+	memnullcheck(fgrid->frame_pos, (3*fgrid->nframe + 1)*sizeof(double), __LINE__-1, __FILE__);
+	fgrid->frame_charge = calloc(fgrid->nframe + 1, sizeof(double));
+	memnullcheck(fgrid->frame_charge, (fgrid->nframe + 1)*sizeof(double), __LINE__-1, __FILE__);
+	fgrid->mix_sigma = calloc(fgrid->ntypes*fgrid->nframe + 1, sizeof(double));
+	memnullcheck(fgrid->mix_sigma, (fgrid->ntypes*fgrid->nframe + 1)*sizeof(double), __LINE__-1, __FILE__);
+	fgrid->mix_epsilon = calloc(fgrid->ntypes*fgrid->nframe + 1, sizeof(double));
+	memnullcheck(fgrid->mix_epsilon, (fgrid->ntypes*fgrid->nframe + 1)*sizeof(double), __LINE__-1, __FILE__);
+	fgrid->mix_flags = calloc(fgrid->ntypes*fgrid->nframe + 1, sizeof(int));
+	memnullcheck(fgrid->mix_flags, (fgrid->ntypes*fgrid->nframe + 1)*sizeof(int), __LINE__-1, __FILE__);
+	fgrid->lrc = calloc(fgrid->ntypes + 1, sizeof(double));
+	memnullcheck(fgrid->lrc, (fgrid->ntypes + 1)*sizeof(double), __LINE__-1, __FILE__);
+
+	j = 0;
+	for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next) {
+		for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
+
+			if(!atom_ptr->frozen) continue;
+
+			for(p = 0; p < 3; p++)
+				fgrid->frame_pos[3*j + p] = atom_ptr->pos[p];
+			fgrid->frame_charge[j] = atom_ptr->charge;
+
+			/* use the same mixing rules and exclusions as the pair kernels */
+			for(t = 0; t < fgrid->ntypes; t++) {
+				memset(&pair, 0, sizeof(pair_t));
+				pair.atom = atom_ptr;
+				pair.molecule = molecule_ptr;
+				pair_exclusions(system, NULL, molecule_ptr, &(fgrid->site[t]), atom_ptr, &pair);
+				pair.frozen = 0; //pair_exclusions hands framework pairs over to the grid
+
+				fgrid->mix_sigma[t*fgrid->nframe + j] = pair.sigma;
+				fgrid->mix_epsilon[t*fgrid->nframe + j] = pair.epsilon;
+				fgrid->mix_flags[t*fgrid->nframe + j] = (pair.rd_excluded ? FRAMEWORK_GRID_RD_EXCLUDED : 0) |
+					(pair.attractive_only ? FRAMEWORK_GRID_ATTRACTIVE : 0);
+
+				/* the LRC doesn't depend on position, so it is kept per type */
+				if(system->rd_lrc)
+					fgrid->lrc[t] += lj_lrc_corr(system, &(fgrid->site[t]), &pair, system->pbc->cutoff);
+			}
+
+			j++;
+		}
+	}
+
+	return;
+}
+
+/* exact framework energies at a point, rd per site type and es per unit charge */
+static void framework_grid_exact(system_t *system, framework_grid_t *fgrid, double *pos, double *rd, double *es) {
+
+	int j, t, p, q, flags;
+	double d[3], img[3], di[3], r, r2;
+	double sigma_over_r, sigma_over_r6, term12;
+	double alpha = system->ewald_alpha;
+	double cutoff = system->pbc->cutoff;
+	pbc_t *pbc = system->pbc;
+
+	*es = 0;
+	for(t = 0; t < fgrid->ntypes; t++)
+		rd[t] = 0;
+
+	for(j = 0; j < fgrid->nframe; j++) {
+
+		/* minimum image, as in minimum_image() */
+		for(p = 0; p < 3; p++)
+			d[p] = pos[p] - fgrid->frame_pos[3*j + p];
+		for(p = 0; p < 3; p++) {
+			for(q = 0, img[p] = 0; q < 3; q++)
+				img[p] += pbc->reciprocal_basis[q][p]*d[q];
+			img[p] = rint(img[p]);
+		}
+		for(p = 0; p < 3; p++)
+			for(q = 0, di[p] = 0; q < 3; q++)
+				di[p] += pbc->basis[q][p]*img[q];
+		for(p = 0, r2 = 0; p < 3; p++) {
+			di[p] = d[p] - di[p];
+			r2 += di[p]*di[p];
+		}
+		r = sqrt(r2);
+		if(r < SMALL_dR) continue; //sitting on a framework atom, the rd wall takes care of it
+
+		if(!system->rd_only && (fgrid->frame_charge[j] != 0.0) && !(r > cutoff))
+			*es += fgrid->frame_charge[j]*erfc(alpha*r)/r;
+
+		if(r - SMALL_dR >= cutoff) continue;
+		for(t = 0; t < fgrid->ntypes; t++) {
+			flags = fgrid->mix_flags[t*fgrid->nframe + j];
+			if(flags & FRAMEWORK_GRID_RD_EXCLUDED) continue;
+
+			sigma_over_r = fabs(fgrid->mix_sigma[t*fgrid->nframe + j])/r;
+			sigma_over_r6 = sigma_over_r*sigma_over_r*sigma_over_r;
+			sigma_over_r6 *= sigma_over_r6;
+			term12 = (flags & FRAMEWORK_GRID_ATTRACTIVE) ? 0 : sigma_over_r6*sigma_over_r6;
+
+			rd[t] += 4.0*fgrid->mix_epsilon[t*fgrid->nframe + j]*(term12 - sigma_over_r6);
+		}
+	}
+
+	return;
+}
+
+/* interpolate a grid at the given (unwrapped) fractional coordinates */
+static double framework_grid_interp(framework_grid_t *fgrid, double *grid, double *s, int capped) {
+
+	int p, a, b, c, i0[3], idx[3][4];
+	double u, t, w[3][4], value, node, node_max, corner_min, corner_max;
+	int *N = fgrid->npts;
+
+	for(p = 0; p < 3; p++) {
+		u = (s[p] - floor(s[p]))*N[p];
+		i0[p] = (int)floor(u);
+		t = u - i0[p];
+		for(a = 0; a < 4; a++)
+			idx[p][a] = (i0[p] - 1 + a + 2*N[p]) % N[p];
+
+		/* catmull-rom weights for nodes i0-1 ... i0+2 */
+		w[p][0] = 0.5*((-t + 2.0)*t - 1.0)*t;
+		w[p][1] = 0.5*((3.0*t - 5.0)*t*t + 2.0);
+		w[p][2] = 0.5*((-3.0*t + 4.0)*t + 1.0)*t;
+		w[p][3] = 0.5*(t - 1.0)*t*t;
+	}
+
+	value = 0;
+	node_max = -MAXVALUE;
+	for(a = 0; a < 4; a++)
+		for(b = 0; b < 4; b++)
+			for(c = 0; c < 4; c++) {
+				node = grid[(idx[0][a]*N[1] + idx[1][b])*N[2] + idx[2][c]];
+				if(node > node_max) node_max = node;
+				value += w[0][a]*w[1][b]*w[2][c]*node;
+			}
+
+	/* next to a wall, keep the spline within the bounds of the surrounding cell's corners */
+	if(capped && (node_max > FRAMEWORK_GRID_ESTEEP)) {
+		corner_min = MAXVALUE;
+		corner_max = -MAXVALUE;
+		for(a = 1; a < 3; a++)
+			for(b = 1; b < 3; b++)
+				for(c = 1; c < 3; c++) {
+					node = grid[(idx[0][a]*N[1] + idx[1][b])*N[2] + idx[2][c]];
+					if(node < corner_min) corner_min = node;
+					if(node > corner_max) corner_max = node;
+				}
+		if(corner_min >= FRAMEWORK_GRID_EMAX) return MAXVALUE;
+		if(value < corner_min) value = corner_min;
+		if(value > corner_max) value = corner_max;
+	}
+
+	return value;
+}
+
+/* fractional coordinates of a cartesian position */
+static void framework_grid_frac(pbc_t *pbc, double *pos, double *s) {
+
+	int p, q;
+
+	for(p = 0; p < 3; p++)
+		for(q = 0, s[p] = 0; q < 3; q++)
+			s[p] += pbc->reciprocal_basis[q][p]*pos[q];
+
+	return;
+}
+
+/* identifies the settings a grid file was built for; the framework itself follows it in the file */
+static void framework_grid_header(system_t *system, framework_grid_t *fgrid, double *header) {
+
+	int p, q;
+
+	memset(header, 0, FRAMEWORK_GRID_HEADER*sizeof(double));
+	header[0] = FRAMEWORK_GRID_VERSION;
+	for(p = 0; p < 3; p++)
+		header[1+p] = fgrid->npts[p];
+	for(p = 0; p < 3; p++)
+		for(q = 0; q < 3; q++)
+			header[4+3*p+q] = system->pbc->basis[p][q];
+	header[13] = system->pbc->cutoff;
+	header[14] = system->ewald_alpha;
+	header[15] = system->rd_only;
+	header[16] = fgrid->nframe;
+	header[17] = fgrid->ntypes;
+
+	return;
+}
+
+/* does the next block of the file hold exactly these n bytes? */
+static int framework_grid_match(FILE *fp, const void *data, size_t n) {
+
+	int ok;
+	char *buffer;
+
+	if(!n) return 1;
+
+	buffer = malloc(n);
+	memnullcheck(buffer, n, __LINE__-1, __FILE__);
+	ok = (fread(buffer, 1, n, fp) == n) && !memcmp(buffer, data, n);
+	free(buffer);
+
+	return ok;
+}
+
+/* returns 0 if the grids were read from the file */
+static int framework_grid_read(system_t *system, framework_grid_t *fgrid) {
+
+	int t, ok;
+	size_t ntotal = (size_t)fgrid->npts[0]*fgrid->npts[1]*fgrid->npts[2];
+	size_t nframe = fgrid->nframe, nmix = (size_t)fgrid->ntypes*fgrid->nframe;
+	double header[FRAMEWORK_GRID_HEADER];
+	FILE *fp;
+
+	fp = fopen(system->framework_grid_file, "rb");
+	if(!fp) return 1;
+
+	/* the settings, then the exact frozen positions, charges and mixed parameters */
+	framework_grid_header(system, fgrid, header);
+	ok = framework_grid_match(fp, header, sizeof(header)) &&
+		framework_grid_match(fp, fgrid->frame_pos, 3*nframe*sizeof(double)) &&
+		framework_grid_match(fp, fgrid->frame_charge, nframe*sizeof(double)) &&
+		framework_grid_match(fp, fgrid->mix_sigma, nmix*sizeof(double)) &&
+		framework_grid_match(fp, fgrid->mix_epsilon, nmix*sizeof(double)) &&
+		framework_grid_match(fp, fgrid->mix_flags, nmix*sizeof(int));
+	if(ok) ok = (fread(fgrid->es, sizeof(double), ntotal, fp) == ntotal);
+	for(t = 0; ok && (t < fgrid->ntypes); t++)
+		ok = (fread(fgrid->rd[t], sizeof(double), ntotal, fp) == ntotal);
+	fclose(fp);
+
+	if(!ok) {
+		output("INPUT: framework grid file does not match this system, rebuilding\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+static void framework_grid_write(system_t *system, framework_grid_t *fgrid) {
+
+	int t;
+	size_t ntotal = (size_t)fgrid->npts[0]*fgrid->npts[1]*fgrid->npts[2];
+	double header[FRAMEWORK_GRID_HEADER];
+	FILE *fp;
+
+	if(rank) return;
+
+	fp = fopen(system->framework_grid_file, "wb");
+	filecheck(fp, system->framework_grid_file, WRITE);
+
+	framework_grid_header(system, fgrid, header);
+	fwrite(header, sizeof(double), FRAMEWORK_GRID_HEADER, fp);
+	fwrite(fgrid->frame_pos, sizeof(double), 3*fgrid->nframe, fp);
+	fwrite(fgrid->frame_charge, sizeof(double), fgrid->nframe, fp);
+	fwrite(fgrid->mix_sigma, sizeof(double), fgrid->ntypes*fgrid->nframe, fp);
+	fwrite(fgrid->mix_epsilon, sizeof(double), fgrid->ntypes*fgrid->nframe, fp);
+	fwrite(fgrid->mix_flags, sizeof(int), fgrid->ntypes*fgrid->nframe, fp);
+	fwrite(fgrid->es, sizeof(double), ntotal, fp);
+	for(t = 0; t < fgrid->ntypes; t++)
+		fwrite(fgrid->rd[t], sizeof(double), ntotal, fp);
+	fclose(fp);
+
+	return;
+}
+
+static void framework_grid_build(system_t *system, framework_grid_t *fgrid) {
+
+	int i, j, k, p, q, t;
+	size_t n;
+	double s[3], pos[3], es, *rd;
+	int *N = fgrid->npts;
+
+	rd = calloc(fgrid->ntypes + 1, sizeof(double));
+	memnullcheck(rd, (fgrid->ntypes + 1)*sizeof(double), __LINE__-1, __FILE__);
+
+	for(i = 0; i < N[0]; i++) {
+		for(j = 0; j < N[1]; j++) {
+			for(k = 0; k < N[2]; k++) {
+
+				s[0] = ((double)i)/N[0];
+				s[1] = ((double)j)/N[1];
+				s[2] = ((double)k)/N[2];
+				for(p = 0; p < 3; p++)
+					for(q = 0, pos[p] = 0; q < 3; q++)
+						pos[p] += system->pbc->basis[q][p]*s[q];
+
+				framework_grid_exact(system, fgrid, pos, rd, &es);
+
+				n = ((size_t)i*N[1] + j)*N[2] + k;
+				fgrid->es[n] = es;
+				for(t = 0; t < fgrid->ntypes; t++)
+					fgrid->rd[t][n] = (rd[t] > FRAMEWORK_GRID_EMAX) ? FRAMEWORK_GRID_EMAX : rd[t];
+			}
+		}
+	}
+
+	free(rd);
+
+	return;
+}
+
+/* compare the interpolated energies against the exact sum at the cell centers */
+static void framework_grid_accuracy(system_t *system, framework_grid_t *fgrid) {
+
+	int i, j, k, p, q, t, stride[3], nsamples, accessible;
+	int *count;
+	double s[3], pos[3], es, es_interp, err;
+	double *rd, *rd_rms, *rd_max, es_rms = 0, es_max = 0;
+	char linebuf[MAXLINE];
+	int *N = fgrid->npts;
+
+	rd = calloc(fgrid->ntypes + 1, sizeof(double));
+	memnullcheck(rd, (fgrid->ntypes + 1)*sizeof(double), __LINE__-1, __FILE__);
+	rd_rms = calloc(fgrid->ntypes + 1, sizeof(double));
+	memnullcheck(rd_rms, (fgrid->ntypes + 1)*sizeof(double), __LINE__-1, __FILE__);
+	rd_max = calloc(fgrid->ntypes + 1, sizeof(double));
+	memnullcheck(rd_max, (fgrid->ntypes + 1)*sizeof(double), __LINE__-1, __FILE__);
+	count = calloc(fgrid->ntypes + 1, sizeof(int));
+	memnullcheck(count, (fgrid->ntypes + 1)*sizeof(int), __LINE__-1, __FILE__);
+
+	for(p = 0; p < 3; p++) {
+		stride[p] = N[p]/FRAMEWORK_GRID_SAMPLES;
+		if(stride[p] < 1) stride[p] = 1;
+	}
+
+	nsamples = 0;
+	for(i = 0; i < N[0]; i += stride[0]) {
+		for(j = 0; j < N[1]; j += stride[1]) {
+			for(k = 0; k < N[2]; k += stride[2]) {
+
+				s[0] = (i + 0.5)/N[0];
+				s[1] = (j + 0.5)/N[1];
+				s[2] = (k + 0.5)/N[2];
+				for(p = 0; p < 3; p++)
+					for(q = 0, pos[p] = 0; q < 3; q++)
+						pos[p] += system->pbc->basis[q][p]*s[q];
+
+				framework_grid_exact(system, fgrid, pos, rd, &es);
+
+				/* only the regions a sorbate can actually visit are of interest */
+				for(t = 0, accessible = !fgrid->ntypes; t < fgrid->ntypes; t++) {
+					if(rd[t] >= 0.0) continue;
+					accessible = 1;
+					err = fabs(framework_grid_interp(fgrid, fgrid->rd[t], s, 1) - rd[t]);
+					rd_rms[t] += err*err;
+					if(err > rd_max[t]) rd_max[t] = err;
+					count[t]++;
+				}
+				if(!accessible) continue;
+
+				es_interp = framework_grid_interp(fgrid, fgrid->es, s, 0);
+				err = fabs(es_interp - es);
+				es_rms += err*err;
+				if(err > es_max) es_max = err;
+				nsamples++;
+			}
+		}
+	}
+
+	sprintf(linebuf, "INPUT: framework grid accuracy at %d accessible cell centers:\n", nsamples);
+	output(linebuf);
+	for(t = 0; t < fgrid->ntypes; t++) {
+		sprintf(linebuf, "INPUT:     site type %d (sigma = %.4f, epsilon = %.4f) rd error rms = %.4e K, max = %.4e K\n",
+			t, fgrid->sigma[t], fgrid->epsilon[t], count[t] ? sqrt(rd_rms[t]/count[t]) : 0.0, rd_max[t]);
+		output(linebuf);
+	}
+	if(!system->rd_only) {
+		sprintf(linebuf, "INPUT:     es potential (per unit charge) error rms = %.4e, max = %.4e\n",
+			nsamples ? sqrt(es_rms/nsamples) : 0.0, es_max);
+		output(linebuf);
+	}
+
+	free(rd);
+	free(rd_rms);
+	free(rd_max);
+	free(count);
+
+	return;
+}
+
+/* tabulate (or read back) the framework grids */
+void setup_framework_grid(system_t *system) {
+
+	int p, q, t;
+	size_t ntotal;
+	double length;
+	char linebuf[MAXLINE];
+	framework_grid_t *fgrid;
+
+	fgrid = calloc(1, sizeof(framework_grid_t));
+	memnullcheck(fgrid, sizeof(framework_grid_t), __LINE__-1, __FILE__);
+	system->framework_grid_data = fgrid;
+
+	framework_grid_add_types(fgrid, system->molecules);
+	framework_grid_add_types(fgrid, system->insertion_molecules);
+	framework_grid_setup_frame(system, fgrid);
+
+	/* number of points along each lattice vector */
+	for(p = 0; p < 3; p++) {
+		for(q = 0, length = 0; q < 3; q++)
+			length += system->pbc->basis[p][q]*system->pbc->basis[p][q];
+		fgrid->npts[p] = (int)ceil(sqrt(length)/system->framework_grid_spacing);
+		if(fgrid->npts[p] < 4) fgrid->npts[p] = 4;
+	}
+	ntotal = (size_t)fgrid->npts[0]*fgrid->npts[1]*fgrid->npts[2];
+
+	fgrid->es = calloc(ntotal, sizeof(double));
+	memnullcheck(fgrid->es, ntotal*sizeof(double), __LINE__-1, __FILE__);
+	fgrid->rd = calloc(fgrid->ntypes + 1, sizeof(double *));
+	memnullcheck(fgrid->rd, (fgrid->ntypes + 1)*sizeof(double *), __LINE__-1, __FILE__);
+	for(t = 0; t < fgrid->ntypes; t++) {
+		fgrid->rd[t] = calloc(ntotal, sizeof(double));
+		memnullcheck(fgrid->rd[t], ntotal*sizeof(double), __LINE__-1, __FILE__);
+	}
+
+	sprintf(linebuf, "INPUT: framework grid of %dx%dx%d points for %d frozen atoms and %d site types\n",
+		fgrid->npts[0], fgrid->npts[1], fgrid->npts[2], fgrid->nframe, fgrid->ntypes);
+	output(linebuf);
+
+	if(system->framework_grid_file && !framework_grid_read(system, fgrid)) {
+		sprintf(linebuf, "INPUT: framework grid read from %s\n", system->framework_grid_file);
+		output(linebuf);
+	} else {
+		framework_grid_build(system, fgrid);
+		output("INPUT: framework grid tabulated\n");
+		if(system->framework_grid_file) {
+			framework_grid_write(system, fgrid);
+			sprintf(linebuf, "INPUT: framework grid written to %s\n", system->framework_grid_file);
+			output(linebuf);
+		}
+	}
+
+	framework_grid_accuracy(system, fgrid);
+
+	return;
+}
+
+/* repulsion/dispersion between one sorbate molecule and the framework */
+double framework_grid_molecule_rd(system_t *system, molecule_t *molecule_ptr) {
+
+	int t;
+	double s[3], potential = 0;
+	atom_t *atom_ptr;
+	framework_grid_t *fgrid = system->framework_grid_data;
+
+	for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
+
+		if(atom_ptr->frozen) continue;
+		if((atom_ptr->sigma == 0.0) || (atom_ptr->epsilon == 0.0)) continue;
+
+		t = framework_grid_type(fgrid, atom_ptr);
+		if(t == -1) {
+			error("FRAMEWORK_GRID: encountered a site type that was not tabulated\n");
+			die(-1);
+		}
+
+		framework_grid_frac(system->pbc, atom_ptr->pos, s);
+		potential += framework_grid_interp(fgrid, fgrid->rd[t], s, 1) + fgrid->lrc[t];
+	}
+
+	return potential;
+}
+
+/* real-space electrostatics between one sorbate molecule and the framework */
+double framework_grid_molecule_es(system_t *system, molecule_t *molecule_ptr) {
+
+	double s[3], potential = 0;
+	atom_t *atom_ptr;
+	framework_grid_t *fgrid = system->framework_grid_data;
+
+	for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
+
+		if(atom_ptr->frozen) continue;
+		if(atom_ptr->charge == 0.0) continue;
+
+		framework_grid_frac(system->pbc, atom_ptr->pos, s);
+		potential += atom_ptr->charge*framework_grid_interp(fgrid, fgrid->es, s, 0);
+	}
+
+	return potential;
+}
+
+/* repulsion/dispersion between the sorbates and the framework */
+double framework_grid_rd(system_t *system) {
+
+	double potential = 0;
+	molecule_t *molecule_ptr;
+
+	for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next)
+		potential += framework_grid_molecule_rd(system, molecule_ptr);
+
+	return potential;
+}
+
+/* real-space electrostatics between the sorbates and the framework */
+double framework_grid_es(system_t *system) {
+
+	double potential = 0;
+	molecule_t *molecule_ptr;
+
+	for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next)
+		potential += framework_grid_molecule_es(system, molecule_ptr);
+
+	return potential;
+}
+
+void free_framework_grid(system_t *system) {
+
+	int t;
+	framework_grid_t *fgrid = system->framework_grid_data;
+
+	if(!fgrid) return;
+
+	for(t = 0; t < fgrid->ntypes; t++)
+		free(fgrid->rd[t]);
+	free(fgrid->rd);
+	free(fgrid->es);
+	free(fgrid->lrc);
+	free(fgrid->mix_sigma);
+	free(fgrid->mix_epsilon);
+	free(fgrid->mix_flags);
+	free(fgrid->frame_pos);
+	free(fgrid->frame_charge);
+	free(fgrid->site);
+	free(fgrid->sigma);
+	free(fgrid->epsilon);
+	free(fgrid);
+	system->framework_grid_data = NULL;
+
+	return;
+}
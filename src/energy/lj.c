@@ -85,6 +85,28 @@ double lj_lrc_corr( system_t * system, atom_t * atom_ptr,  pair_t * pair_ptr, do
 
 }
 
+/* the pair LRC's don't depend on separation, so with the neighbor list they are summed over */
+/* every pair only when the pairs or the volume changed; a build that walks the pairs sums them itself */
+double lj_lrc_pairs ( system_t * system, double cutoff ) {
+
+	molecule_t * molecule_ptr;
+	atom_t * atom_ptr;
+	pair_t * pair_ptr;
+
+	if ( system->neighbor_rd_lrc_stale ) {
+		system->neighbor_rd_lrc = 0;
+		for ( molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next )
+			for ( atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next )
+				for ( pair_ptr = atom_ptr->pairs; pair_ptr; pair_ptr = pair_ptr->next ) {
+					pair_ptr->lrc = lj_lrc_corr(system,atom_ptr,pair_ptr,cutoff);
+					system->neighbor_rd_lrc += pair_ptr->lrc;
+				}
+		system->neighbor_rd_lrc_stale = 0;
+	}
+
+	return system->neighbor_rd_lrc;
+}
+
 double lj_lrc_self ( system_t * system, atom_t * atom_ptr, double cutoff ) {
 	double sig_cut, sig3, sig_cut3, sig_cut9;
 
@@ -182,14 +204,14 @@ double lj(system_t *system) {
 	potential = 0;
 	for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next) {
 		for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
-			for(pair_ptr = atom_ptr->pairs; pair_ptr; pair_ptr = pair_ptr->next) {
+			for(pair_ptr = PAIR_HEAD(system,atom_ptr); pair_ptr; pair_ptr = PAIR_NEXT(system,pair_ptr)) {
 
 				if(pair_ptr->recalculate_energy) {
 
 					pair_ptr->rd_energy = 0;
 
-					// pair LRC 
-					if ( system->rd_lrc ) pair_ptr->lrc = lj_lrc_corr(system,atom_ptr,pair_ptr,cutoff);
+					// pair LRC (summed over all pairs in lj_lrc_pairs() when using the neighbor list)
+					if ( system->rd_lrc && !system->neighbor_list ) pair_ptr->lrc = lj_lrc_corr(system,atom_ptr,pair_ptr,cutoff);
 
 					// to include a contribution, we require
 					if ( 	( pair_ptr->rimg - SMALL_dR < cutoff ) && //inside cutoff?
@@ -259,12 +281,20 @@ double lj(system_t *system) {
 				} /* if recalculate */
 
 				/* sum all of the pairwise terms */
-				potential += pair_ptr->rd_energy + pair_ptr->lrc;
+				potential += pair_ptr->rd_energy;
+				if ( !system->neighbor_list ) potential += pair_ptr->lrc;
 
 			} /* pair */
 		} /* atom */
 	} /* molecule */
 
+	if ( system->rd_lrc && system->neighbor_list )
+		potential += lj_lrc_pairs(system,cutoff);
+
+	/* sorbate-framework interactions */
+	if ( system->framework_grid )
+		potential += framework_grid_rd(system);
+
 	/* molecule self-energy for rd_crystal -> energy of molecule interacting with its periodic neighbors */
 
 	if ( system->rd_crystal )
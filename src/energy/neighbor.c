@@ -0,0 +1,338 @@
+/*
+
+Space Research Group
+Department of Chemistry
+University of South Florida
+
+Verlet neighbor list built on a linked-cell decomposition of the (triclinic) unit cell.
+The list is threaded through the existing pair_t nodes (nlist/nlist_next), so kernels
+keep their per-pair caches and only walk the pairs within cutoff+skin. Each atom indexes
+its pairs (pair_index), so a rebuild after the atoms moved is linear in the number of atoms.
+
+*/
+
+#include <mc.h>
+
+/* minimum image separation squared, same convention as minimum_image() */
+static double neighbor_rimg2(pbc_t *pbc, double *pos_i, double *pos_j) {
+
+	int p, q;
+	double d[3], img[3], di[3], r2;
+
+	for(p = 0; p < 3; p++)
+		d[p] = pos_i[p] - pos_j[p];
+
+	for(p = 0; p < 3; p++) {
+		for(q = 0, img[p] = 0; q < 3; q++)
+			img[p] += pbc->reciprocal_basis[q][p]*d[q];
+		img[p] = rint(img[p]);
+	}
+
+	for(p = 0; p < 3; p++)
+		for(q = 0, di[p] = 0; q < 3; q++)
+			di[p] += pbc->basis[q][p]*img[q];
+
+	for(p = 0, r2 = 0; p < 3; p++) {
+		di[p] = d[p] - di[p];
+		r2 += di[p]*di[p];
+	}
+
+	return r2;
+}
+
+/* do any of the pair consumers need every pair imaged, not just the neighbors? */
+int neighbor_list_full_update(system_t *system) {
+
+	//A-matrix, ewald field and cdvdw have no cutoff
+	if(system->polarization || system->polarvdw) return 1;
+	//checks every pair
+	if(system->cavity_autoreject_absolute) return 1;
+
+	return 0;
+}
+
+/* has any atom moved more than half the skin since the last build? */
+int neighbor_list_expired(system_t *system) {
+
+	int i, p;
+	double d, dr2, max_dr2;
+	atom_t *atom_ptr;
+
+	if(system->neighbor_list_stale) return 1;
+	if(system->neighbor_list_natoms != system->natoms) return 1;
+	if(system->neighbor_list_volume != system->pbc->volume) return 1;
+
+	max_dr2 = 0.25*system->neighbor_skin*system->neighbor_skin;
+	for(i = 0; i < system->natoms; i++) {
+		atom_ptr = system->atom_array[i];
+		for(p = 0, dr2 = 0; p < 3; p++) {
+			d = atom_ptr->pos[p] - atom_ptr->nlist_pos[p];
+			dr2 += d*d;
+		}
+		if(dr2 > max_dr2) return 1;
+	}
+
+	return 0;
+}
+
+/* link up the pairs of an atom that are flagged as neighbor list members */
+void neighbor_list_thread(atom_t *atom_ptr) {
+
+	pair_t *pair_ptr, *prev_pair_ptr;
+
+	atom_ptr->nlist = NULL;
+	prev_pair_ptr = NULL;
+	for(pair_ptr = atom_ptr->pairs; pair_ptr; pair_ptr = pair_ptr->next) {
+		pair_ptr->nlist_next = NULL;
+		if(!pair_ptr->nlist_member) continue;
+
+		if(prev_pair_ptr)
+			prev_pair_ptr->nlist_next = pair_ptr;
+		else
+			atom_ptr->nlist = pair_ptr;
+		prev_pair_ptr = pair_ptr;
+	}
+
+	return;
+}
+
+/* index the pairs of an atom in list order, to be redone whenever pairs are added or freed */
+void neighbor_list_index(atom_t *atom_ptr) {
+
+	int n;
+	pair_t *pair_ptr;
+
+	free(atom_ptr->pair_index);
+	atom_ptr->pair_index = NULL;
+
+	for(pair_ptr = atom_ptr->pairs, n = 0; pair_ptr; pair_ptr = pair_ptr->next) n++;
+	if(!n) return;
+
+	atom_ptr->pair_index = calloc(n, sizeof(pair_t *));
+	memnullcheck(atom_ptr->pair_index, n*sizeof(pair_t *), __LINE__-1, __FILE__);
+	for(pair_ptr = atom_ptr->pairs, n = 0; pair_ptr; pair_ptr = pair_ptr->next)
+		atom_ptr->pair_index[n++] = pair_ptr;
+
+	return;
+}
+
+/* the pair of atom_array[i] with atom_array[j], j > i; mobile[k] counts the unfrozen atoms below k */
+static pair_t *neighbor_pair(system_t *system, int *mobile, int i, int j) {
+
+	atom_t **atom_array = system->atom_array;
+
+	if(PAIR_PRUNED(system, atom_array[i], atom_array[j])) return NULL;
+	//a pruned frozen atom only has pairs with the unfrozen atoms
+	if(system->prune_frozen_pairs && atom_array[i]->frozen)
+		return atom_array[i]->pair_index[mobile[j] - mobile[i + 1]];
+
+	return atom_array[i]->pair_index[j - i - 1];
+}
+
+static int neighbor_compare(const void *a, const void *b) {
+
+	return *(const int *)a - *(const int *)b;
+}
+
+/* put a pair on the list being built. the energy of a pair that wasn't on the old list may be stale; if the pair */
+/* hasn't been imaged yet, minimum_image() would clear the flag, so pairs() flags it once it has (NEIGHBOR_ENTERED) */
+static void neighbor_list_join(pair_t *pair_ptr, int imaged, pair_t **member, int *nmembers) {
+
+	if(pair_ptr->nlist_member)
+		pair_ptr->nlist_member = 1;
+	else if(imaged) {
+		pair_ptr->nlist_member = 1;
+		pair_ptr->recalculate_energy = 1;
+	}
+	else
+		pair_ptr->nlist_member = NEIGHBOR_ENTERED;
+	member[(*nmembers)++] = pair_ptr;
+
+	return;
+}
+
+/* rebuild the neighbor list. pairs() walks (and images) every pair when pairs were added or freed, or when */
+/* another consumer needs them all, and the list is then taken from the pairs; otherwise the members are */
+/* found from the cells without walking the pairs */
+void neighbor_list_build(system_t *system) {
+
+	int i, j, k, n, p, q, c, ncells, use_cells, relink, imaged, lrc, npairs, ncandidates, nmembers, nleaving;
+	int ncell[3], cell_i[3], cell_j[3], offset[3];
+	int *cell, *cell_head, *cell_next, *neighbor, *candidate, *mobile;
+	double s, rlist, rlist2, width;
+	atom_t **atom_array = system->atom_array;
+	molecule_t **molecule_array = system->molecule_array;
+	pair_t *pair_ptr, **member, **leaving;
+	pbc_t *pbc = system->pbc;
+
+	n = system->natoms;
+	rlist = pbc->cutoff + system->neighbor_skin + SMALL_dR;
+	rlist2 = rlist*rlist;
+	relink = system->neighbor_list_stale;
+	imaged = relink || neighbor_list_full_update(system);
+	//the pair LRC's (see lj_lrc_pairs) only change with the pairs themselves or the volume
+	lrc = imaged && system->rd_lrc && !system->sg && (relink || (system->neighbor_list_volume != pbc->volume));
+	if(lrc) system->neighbor_rd_lrc = 0;
+
+	/* number of cells along each lattice vector, from the spacing of the lattice planes */
+	for(p = 0, use_cells = 1; p < 3; p++) {
+		for(q = 0, width = 0; q < 3; q++)
+			width += pbc->reciprocal_basis[q][p]*pbc->reciprocal_basis[q][p];
+		width = 1.0/sqrt(width);
+		ncell[p] = (int)floor(width/rlist);
+		//the 27 cell stencil is only unique with at least 3 cells per direction
+		if(ncell[p] < 3) use_cells = 0;
+	}
+	ncells = use_cells ? ncell[0]*ncell[1]*ncell[2] : 1;
+
+	cell = calloc(n, sizeof(int));
+	memnullcheck(cell, n*sizeof(int), __LINE__-1, __FILE__);
+	cell_next = calloc(n, sizeof(int));
+	memnullcheck(cell_next, n*sizeof(int), __LINE__-1, __FILE__);
+	cell_head = calloc(ncells, sizeof(int));
+	memnullcheck(cell_head, ncells*sizeof(int), __LINE__-1, __FILE__);
+	neighbor = calloc(n, sizeof(int));
+	memnullcheck(neighbor, n*sizeof(int), __LINE__-1, __FILE__);
+	candidate = calloc(n, sizeof(int));
+	memnullcheck(candidate, n*sizeof(int), __LINE__-1, __FILE__);
+	mobile = calloc(n + 1, sizeof(int));
+	memnullcheck(mobile, (n + 1)*sizeof(int), __LINE__-1, __FILE__);
+	member = calloc(n, sizeof(pair_t *));
+	memnullcheck(member, n*sizeof(pair_t *), __LINE__-1, __FILE__);
+	leaving = calloc(n, sizeof(pair_t *));
+	memnullcheck(leaving, n*sizeof(pair_t *), __LINE__-1, __FILE__);
+
+	for(i = 0; i < n; i++)
+		mobile[i + 1] = mobile[i] + !atom_array[i]->frozen;
+
+	/* bin the atoms by fractional coordinate */
+	for(c = 0; c < ncells; c++) cell_head[c] = -1;
+	for(i = n - 1; i >= 0; i--) {
+		if(use_cells) {
+			for(p = 0; p < 3; p++) {
+				for(q = 0, s = 0; q < 3; q++)
+					s += pbc->reciprocal_basis[q][p]*atom_array[i]->pos[q];
+				s -= floor(s);
+				cell_i[p] = (int)(s*ncell[p]);
+				if(cell_i[p] >= ncell[p]) cell_i[p] = ncell[p] - 1;
+			}
+			cell[i] = (cell_i[0]*ncell[1] + cell_i[1])*ncell[2] + cell_i[2];
+		}
+		cell_next[i] = cell_head[cell[i]];
+		cell_head[cell[i]] = i;
+	}
+
+	for(i = 0; i < (n - 1); i++) {
+
+		/* pairs() has just imaged every pair, so the members can be read off the pairs in one walk */
+		if(imaged) {
+			if(relink) {
+				npairs = (system->prune_frozen_pairs && atom_array[i]->frozen) ? (mobile[n] - mobile[i + 1]) : (n - i - 1);
+				atom_array[i]->pair_index = realloc(atom_array[i]->pair_index, (npairs + 1)*sizeof(pair_t *));
+				memnullcheck(atom_array[i]->pair_index, (npairs + 1)*sizeof(pair_t *), __LINE__-1, __FILE__);
+			}
+			for(pair_ptr = atom_array[i]->pairs, k = 0, nmembers = 0; pair_ptr; pair_ptr = pair_ptr->next) {
+				if(relink) atom_array[i]->pair_index[k++] = pair_ptr;
+				if(lrc) {
+					pair_ptr->lrc = lj_lrc_corr(system, atom_array[i], pair_ptr, pbc->cutoff);
+					system->neighbor_rd_lrc += pair_ptr->lrc;
+				}
+				/* frozen pairs never contribute; intramolecular pairs carry the ewald self terms */
+				if(!pair_ptr->frozen && ((pair_ptr->rimg < rlist) || (pair_ptr->molecule == molecule_array[i])))
+					neighbor_list_join(pair_ptr, imaged, member, &nmembers);
+				else
+					pair_ptr->nlist_member = 0;
+			}
+		}
+
+		/* otherwise from the cells, and the index to reach their pairs */
+		else {
+			for(pair_ptr = atom_array[i]->nlist, nleaving = 0; pair_ptr; pair_ptr = pair_ptr->nlist_next) {
+				pair_ptr->nlist_member = NEIGHBOR_LEAVING;
+				leaving[nleaving++] = pair_ptr;
+			}
+
+			/* collect the j > i atoms within rlist, stamped with i+1 so the array never needs clearing */
+			ncandidates = 0;
+			if(use_cells) {
+				cell_i[0] = cell[i]/(ncell[1]*ncell[2]);
+				cell_i[1] = (cell[i]/ncell[2]) % ncell[1];
+				cell_i[2] = cell[i] % ncell[2];
+				for(offset[0] = -1; offset[0] <= 1; offset[0]++)
+				for(offset[1] = -1; offset[1] <= 1; offset[1]++)
+				for(offset[2] = -1; offset[2] <= 1; offset[2]++) {
+					for(p = 0; p < 3; p++)
+						cell_j[p] = (cell_i[p] + offset[p] + ncell[p]) % ncell[p];
+					c = (cell_j[0]*ncell[1] + cell_j[1])*ncell[2] + cell_j[2];
+					for(j = cell_head[c]; j != -1; j = cell_next[j]) {
+						if(j <= i) continue;
+						if(neighbor_rimg2(pbc, atom_array[i]->pos, atom_array[j]->pos) < rlist2) {
+							neighbor[j] = i + 1;
+							candidate[ncandidates++] = j;
+						}
+					}
+				}
+			}
+			else {
+				for(j = i + 1; j < n; j++)
+					if(neighbor_rimg2(pbc, atom_array[i]->pos, atom_array[j]->pos) < rlist2) {
+						neighbor[j] = i + 1;
+						candidate[ncandidates++] = j;
+					}
+			}
+
+			/* intramolecular pairs carry the ewald self terms; a frozen molecule's are all frozen */
+			if(!(atom_array[i]->frozen && molecule_array[i]->frozen))
+				for(j = i + 1; (j < n) && (molecule_array[j] == molecule_array[i]); j++)
+					if(neighbor[j] != i + 1) {
+						neighbor[j] = i + 1;
+						candidate[ncandidates++] = j;
+					}
+
+			/* keep the list in pair order, so the kernels sum in the same order as without the list */
+			qsort(candidate, ncandidates, sizeof(int), neighbor_compare);
+
+			for(k = 0, nmembers = 0; k < ncandidates; k++) {
+				pair_ptr = neighbor_pair(system, mobile, i, candidate[k]);
+				if(pair_ptr && !pair_ptr->frozen)
+					neighbor_list_join(pair_ptr, imaged, member, &nmembers);
+			}
+
+			/* drop the pairs that left */
+			for(k = 0; k < nleaving; k++)
+				if(leaving[k]->nlist_member == NEIGHBOR_LEAVING) leaving[k]->nlist_member = 0;
+		}
+
+		atom_array[i]->nlist = nmembers ? member[0] : NULL;
+		for(k = 0; k < nmembers; k++)
+			member[k]->nlist_next = (k + 1 < nmembers) ? member[k + 1] : NULL;
+
+	}
+	if(n) atom_array[n-1]->nlist = NULL;
+
+	/* the pair LRC's were summed on the way, or lj_lrc_pairs() has to walk the pairs for them */
+	if(lrc)
+		system->neighbor_rd_lrc_stale = 0;
+	else if(system->neighbor_list_volume != pbc->volume)
+		system->neighbor_rd_lrc_stale = 1;
+
+	/* record the reference state */
+	for(i = 0; i < n; i++)
+		for(p = 0; p < 3; p++)
+			atom_array[i]->nlist_pos[p] = atom_array[i]->pos[p];
+	system->neighbor_list_natoms = n;
+	system->neighbor_list_volume = pbc->volume;
+	system->neighbor_list_stale = 0;
+	system->neighbor_list_builds++;
+
+	free(cell);
+	free(cell_next);
+	free(cell_head);
+	free(neighbor);
+	free(candidate);
+	free(mobile);
+	free(member);
+	free(leaving);
+
+	return;
+}
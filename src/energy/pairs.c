@@ -60,6 +60,8 @@ void pair_exclusions(system_t *system, molecule_t *molecule_i, molecule_t *molec
 
 	double si3, sj3, si6, sj6;
 	double repul1, repul2, repulmix;
+	disp_mix_t disp_mix_atoms;
+	const disp_mix_t *disp_mix;
 
 	/* recalculate exclusions */
 	if((molecule_i == molecule_j) && !system->gwp) { /* if both on same molecule, exclude all interactions */
@@ -86,6 +88,12 @@ void pair_exclusions(system_t *system, molecule_t *molecule_i, molecule_t *molec
 	/* get the frozen interactions */
 	pair_ptr->frozen = atom_i->frozen && atom_j->frozen;
 
+	/* framework interactions are taken from the framework grids instead */
+	if(system->framework_grid && (atom_i->frozen || atom_j->frozen) && !pair_ptr->frozen) {
+		pair_ptr->frozen = 1;
+		pair_ptr->rd_energy = pair_ptr->es_real_energy = pair_ptr->es_self_intra_energy = pair_ptr->lrc = 0;
+	}
+
 	/* get the mixed LJ parameters */
 	if(!system->sg) {
 		if (system->waldmanhagler && !system->cdvdw_sig_repulsion) { //wh mixing rule
@@ -152,63 +160,19 @@ void pair_exclusions(system_t *system, molecule_t *molecule_i, molecule_t *molec
 			// sigma == r, epsilon == alpha, C ~= 316 K
 			// U = C exp(-alpha(R-r))
 
-			// forumlas for these (except JR Schmidt's mixing rule) is here http://pubs.acs.org/doi/pdf/10.1021/acs.jpca.6b10295
-			if (system->schmidt_mixing)
-			{
-				pair_ptr->sigma = 0.5*(atom_i->sigma + atom_j->sigma);
-				pair_ptr->epsilon = (atom_i->epsilon+atom_j->epsilon)*atom_i->epsilon*atom_j->epsilon/(atom_i->epsilon*atom_i->epsilon+atom_j->epsilon*atom_j->epsilon);
-			}
-			else if (system->gilbert_smith_mixing)
-			{
-				double c = 315.7750382111558307123944638; // don't confuse this for C, which is #defined as the speed of light
-				double Aii = c * exp(atom_i->epsilon*atom_i->sigma);
-				double Ajj = c * exp(atom_j->epsilon*atom_j->sigma);
-				double Bii = atom_i->epsilon;
-				double Bjj = atom_j->epsilon;
-				pair_ptr->epsilon = 2.0*atom_i->epsilon*atom_j->epsilon/(atom_i->epsilon + atom_j->epsilon);
-				double Bij = pair_ptr->epsilon;
-				double Aij = pow(pow(Aii*Bii,1.0/Bii)*pow(Ajj*Bjj,1.0/Bjj),0.5*Bij)/Bij;
-				pair_ptr->sigma = log(Aij/c)/Bij;
-			}
-			else if (system->bohm_ahlrichs_mixing)
-			{
-				double c = 315.7750382111558307123944638;
-				double Aii = c * exp(atom_i->epsilon*atom_i->sigma);
-				double Ajj = c * exp(atom_j->epsilon*atom_j->sigma);
-				double Bii = atom_i->epsilon;
-				double Bjj = atom_j->epsilon;
-				pair_ptr->epsilon = 2.0*atom_i->epsilon*atom_j->epsilon/(atom_i->epsilon + atom_j->epsilon);
-				double Bij = pair_ptr->epsilon;
-				double Aij = pow(pow(Aii,1.0/Bii)*pow(Ajj,1.0/Bjj),0.5*Bij);
-				pair_ptr->sigma = log(Aij/c)/Bij;
-			}
-			else if (system->wilson_popelier_mixing)
-			{
-				double c = 315.7750382111558307123944638;
-				double Aii = c * exp(atom_i->epsilon*atom_i->sigma);
-				double Ajj = c * exp(atom_j->epsilon*atom_j->sigma);
-				double Bii = atom_i->epsilon;
-				double Bjj = atom_j->epsilon;
-				pair_ptr->epsilon = sqrt(0.5*(Bii*Bii+Bjj*Bjj));
-				double Aij = pow(0.5*(pow(Aii,0.4)+pow(Ajj,0.4)),1.0/0.4);
-				pair_ptr->sigma = log(Aij/c)/pair_ptr->epsilon;
+			// mixed once for each pair of atom types, see disp_expansion.c; surf_fit changes the parameters as it goes
+			if (system->ensemble == ENSEMBLE_SURF_FIT) {
+				disp_expansion_mix_atoms(system, atom_i, atom_j, &disp_mix_atoms);
+				disp_mix = &disp_mix_atoms;
 			}
 			else
-			{
-				pair_ptr->sigma = 0.5*(atom_i->sigma + atom_j->sigma);
-				pair_ptr->epsilon = 2.0*atom_i->epsilon*atom_j->epsilon/(atom_i->epsilon + atom_j->epsilon);
-			}
-
-			/* get mixed dispersion coefficients */
-			pair_ptr->c6 = sqrt(atom_i->c6*atom_j->c6)*0.021958709/(3.166811429*0.000001); // Convert H*Bohr^6 to K*Angstrom^6, etc
-			pair_ptr->c8 = sqrt(atom_i->c8*atom_j->c8)*0.0061490647/(3.166811429*0.000001); // Dispersion coeffs should be inputed in a.u.
+				disp_mix = disp_expansion_mix(system, atom_i, atom_j);
 
-			if (system->extrapolate_disp_coeffs&&pair_ptr->c6!=0.0&&pair_ptr->c8!=0.0)
-				pair_ptr->c10 = 49.0/40.0*pair_ptr->c8*pair_ptr->c8/pair_ptr->c6;
-			else if (system->extrapolate_disp_coeffs)
-				pair_ptr->c10 = 0.0; //either c6 or c8 is zero so lets set c10 to zero too
-			else
-				pair_ptr->c10 = sqrt(atom_i->c10*atom_j->c10)*0.0017219135/(3.166811429*0.000001);
+			pair_ptr->sigma = disp_mix->sigma;
+			pair_ptr->epsilon = disp_mix->epsilon;
+			pair_ptr->c6 = disp_mix->c6;
+			pair_ptr->c8 = disp_mix->c8;
+			pair_ptr->c10 = disp_mix->c10;
 		}
 		else if (system->c6_mixing) {
 			pair_ptr->sigma = 0.5*(atom_i->sigma + atom_j->sigma);
@@ -321,7 +285,8 @@ void minimum_image(system_t *system, atom_t *atom_i, atom_t *atom_j, pair_t *pai
 /* update everything necessary to describe the complete pairwise system */
 void pairs(system_t *system) {
 
-	int i, j, n;
+	int i, j, n, rank;
+	int nlist_expired = 0, nlist_only;
 	// molecule_t *molecule_ptr;     (unused variable)
 	// atom_t *atom_ptr;    (unused variable)
 	pair_t *pair_ptr;
@@ -330,7 +295,7 @@ void pairs(system_t *system) {
 	/* needed for GS ranking metric */
 	// int p;   (unused variable)
 	// double r;    (unused variable)
-	double rmin;
+	double rmin = MAXVALUE, rank_cutoff;
 
 	// get array of atom ptrs
 	rebuild_arrays(system);
@@ -338,13 +303,52 @@ void pairs(system_t *system) {
 	molecule_array = system->molecule_array;
 	n=system->natoms;
 
+	/* the GS rank metric is counted as the pairs are imaged, against the smallest */
+	/* polarizable separation of the last call; polarization always takes the full loop */
+	rank = system->polar_iterative && system->polar_gs_ranked;
+	rank_cutoff = 1.5*system->polar_rank_rmin;
+	if(rank)
+		for(i = 0; i < n; i++)
+			atom_array[i]->rank_metric = 0;
+
+	if(system->neighbor_list) nlist_expired = neighbor_list_expired(system);
+	nlist_only = system->neighbor_list && !neighbor_list_full_update(system);
+
+	/* the atoms moved past the skin, but the pairs are as they were: rebuild from the positions alone */
+	if(nlist_only && nlist_expired && !system->neighbor_list_stale) {
+		neighbor_list_build(system);
+		nlist_expired = 0;
+	}
+
+	/* the neighbor list is valid, so only the pairs on it need updating */
+	if(nlist_only && !nlist_expired) {
+		for(i = 0; i < (n - 1); i++) {
+			for(pair_ptr = atom_array[i]->nlist; pair_ptr; pair_ptr = pair_ptr->nlist_next) {
+				j = pair_ptr->nlist_index;
+				pair_ptr->atom = atom_array[j];
+				pair_ptr->molecule = molecule_array[j];
+				pair_exclusions(system, molecule_array[i], molecule_array[j], atom_array[i], atom_array[j], pair_ptr);
+				minimum_image(system, atom_array[i], atom_array[j], pair_ptr);
+				//the energy of a pair that just joined the list may be stale
+				if(pair_ptr->nlist_member == NEIGHBOR_ENTERED) {
+					pair_ptr->recalculate_energy = 1;
+					pair_ptr->nlist_member = 1;
+				}
+			}
+		}
+	}
+
 	/* loop over all atoms and pair */
-	for(i = 0; i < (n - 1); i++) {
-		for(j = (i + 1), pair_ptr = atom_array[i]->pairs; j < n; j++, pair_ptr = pair_ptr->next) {
+	else for(i = 0; i < (n - 1); i++) {
+		for(j = (i + 1), pair_ptr = atom_array[i]->pairs; j < n; j++) {
+
+			/* no pair was allocated for this one */
+			if(PAIR_PRUNED(system, atom_array[i], atom_array[j])) continue;
 
 			/* set the link */
 			pair_ptr->atom = atom_array[j];
 			pair_ptr->molecule = molecule_array[j];
+			pair_ptr->nlist_index = j;
 
 			//this is dangerous and has already been responsible for numerous bugs, most recently
 			//in UVT runs. after and insert/remove move there is no guarantee that pair_ptr->rd_excluded is properly set
@@ -355,9 +359,21 @@ void pairs(system_t *system) {
 			if( !pair_ptr->frozen || system->polarization ) //need induced-induced interaction for frozen atoms
 				minimum_image(system, atom_array[i], atom_array[j], pair_ptr);
 
+			if(rank && (atom_array[i]->polarizability != 0.0) && (atom_array[j]->polarizability != 0.0)) {
+				if(pair_ptr->rimg < rmin) rmin = pair_ptr->rimg;
+				if(pair_ptr->r <= rank_cutoff) {
+					atom_array[i]->rank_metric += 1.0;
+					atom_array[j]->rank_metric += 1.0;
+				}
+			}
+
+			pair_ptr = pair_ptr->next;
+
 		} /* for j */
 	} /* for i */
 
+	if(nlist_expired) neighbor_list_build(system);
+
 
 	/* update the com of each molecule */
 	update_com(system->molecules);
@@ -365,25 +381,17 @@ void pairs(system_t *system) {
 	/* store wrapped coords */
 	wrapall(system->molecules, system->pbc);
 
-	/* rank metric */
-	if(system->polar_iterative && system->polar_gs_ranked) {
-		/* determine smallest polarizable separation */
-		rmin = MAXVALUE;
-		for(i = 0; i < n; i++) {
-			if ( atom_array[i]->polarizability == 0.0 )	continue;
-			for ( pair_ptr = atom_array[i]->pairs; pair_ptr; pair_ptr=pair_ptr->next ) {
-				if ( pair_ptr->atom->polarizability == 0.0 ) continue; 
-				if ( pair_ptr->rimg < rmin ) rmin = pair_ptr->rimg;
-			}
-		}
-		//calculate rank shits
+	/* rank metric: only if the smallest separation moved do the counts need redoing */
+	if(rank && (rmin != system->polar_rank_rmin)) {
+		system->polar_rank_rmin = rmin;
+		rank_cutoff = 1.5*rmin;
 		for(i = 0; i < n; i++ )
 			atom_array[i]->rank_metric = 0;	
 		for(i = 0; i < n; i++) {
 			if ( atom_array[i]->polarizability == 0.0 )	continue;
 			for ( pair_ptr = atom_array[i]->pairs; pair_ptr; pair_ptr=pair_ptr->next ) {
 				if ( pair_ptr->atom->polarizability == 0.0 ) continue; 
-				if ( pair_ptr->r <= rmin*1.5 ) {
+				if ( pair_ptr->r <= rank_cutoff ) {
 					atom_array[i]->rank_metric += 1.0;
 					pair_ptr->atom->rank_metric += 1.0;
 				}
@@ -472,6 +480,9 @@ void update_pairs_insert(system_t *system) {
 		} /* for atom */
 	} /* for molecule */
 
+	/* pairs were added or freed */
+	system->neighbor_list_stale = 1;
+
 }
 
 /* remove pairs when a molecule is deleted */
@@ -516,6 +527,9 @@ void update_pairs_remove(system_t *system) {
 	/* free our temporary array */
 	free(pair_array);
 
+	/* pairs were added or freed */
+	system->neighbor_list_stale = 1;
+
 }
 
 /* if an insert move is rejected, remove the pairs that were previously added */
@@ -561,6 +575,9 @@ void unupdate_pairs_insert(system_t *system) {
 	/* free our temporary array */
 	free(pair_array);
 
+	/* pairs were added or freed */
+	system->neighbor_list_stale = 1;
+
 }
 
 /* if a remove is rejected, then add back the pairs that were previously deleted */
@@ -611,6 +628,8 @@ void unupdate_pairs_remove(system_t *system) {
 		} /* for atom */
 	} /* for molecule */
 
+	/* pairs were added or freed */
+	system->neighbor_list_stale = 1;
 
 }
 
@@ -634,19 +653,26 @@ void setup_pairs(system_t * system) {
 		atom_array[i]->pairs = calloc(1, sizeof(pair_t));
 		memnullcheck(atom_array[i]->pairs,sizeof(pair_t),__LINE__-1, __FILE__);	
 		pair_ptr = atom_array[i]->pairs;
-		prev_pair_ptr = pair_ptr;
+		prev_pair_ptr = NULL;
 
 		for(j = (i + 1); j < n; j++) {
+			if(PAIR_PRUNED(system, atom_array[i], atom_array[j])) continue;
 			pair_ptr->next = calloc(1, sizeof(pair_t));
 			memnullcheck(pair_ptr->next,sizeof(pair_t),__LINE__-1, __FILE__);
 			prev_pair_ptr = pair_ptr;
 			pair_ptr = pair_ptr->next;
 		}
 
-		prev_pair_ptr->next = NULL;
+		/* drop the spare node, leaving an empty list if every pair was pruned */
+		if(prev_pair_ptr)
+			prev_pair_ptr->next = NULL;
+		else
+			atom_array[i]->pairs = NULL;
 		free(pair_ptr);
 	}
 
+	system->neighbor_list_stale = 1;
+
 }
 
 #ifdef DEBUG
@@ -62,6 +62,11 @@ double polar(system_t *system) {
 		num_iterations = thole_iterative(system); //calc dipoles
 
 		system->nodestats->polarization_iterations = (double)num_iterations; //statistics
+		if(!system->polar_iteration_histogram) {
+			system->polar_iteration_histogram = calloc(MAX_ITERATION_COUNT + 1, sizeof(int));
+			memnullcheck(system->polar_iteration_histogram, (MAX_ITERATION_COUNT + 1)*sizeof(int), __LINE__-1, __FILE__);
+		}
+		system->polar_iteration_histogram[(num_iterations < MAX_ITERATION_COUNT) ? num_iterations : MAX_ITERATION_COUNT]++;
 		system->observables->dipole_rrms = get_dipole_rrms(system);
 
 		if ( system->iter_success ) {
@@ -86,6 +91,11 @@ double polar(system_t *system) {
 			}
 		}
 
+	} else if(!system->polarizability_tensor) {
+		//solve for the dipoles directly
+		thole_field(system); //calc e-field
+		thole_solve_dipoles(system); //cholesky factorization and solve
+
 	} else {	
 		//do matrix inversion
 		thole_field(system); //calc e-field
@@ -93,12 +103,10 @@ double polar(system_t *system) {
 		thole_bmatrix_dipoles(system); //get dipoles
 
 		/* output the 3x3 molecular polarizability tensor */
-		if(system->polarizability_tensor) {
-			output("POLAR: B matrix:\n");
-			print_matrix(3*((int)system->checkpoint->thole_N_atom), system->B_matrix);
-			thole_polarizability_tensor(system);
-			die(0);
-		}
+		output("POLAR: B matrix:\n");
+		print_matrix(3*((int)system->checkpoint->thole_N_atom), system->B_matrix);
+		thole_polarizability_tensor(system);
+		die(0);
 	}
 
 	/* calculate the polarization energy as 1/2 mu*E */
@@ -29,7 +29,7 @@ double sg(system_t *system) {
 
 	for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next) {
 		for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
-			for(pair_ptr = atom_ptr->pairs; pair_ptr; pair_ptr = pair_ptr->next) {
+			for(pair_ptr = PAIR_HEAD(system,atom_ptr); pair_ptr; pair_ptr = PAIR_NEXT(system,pair_ptr)) {
 
 				if(pair_ptr->recalculate_energy) {
 
@@ -99,7 +99,7 @@ double sg(system_t *system) {
 	potential = 0;
 	for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next)
 		for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next)
-			for(pair_ptr = atom_ptr->pairs; pair_ptr; pair_ptr = pair_ptr->next)
+			for(pair_ptr = PAIR_HEAD(system,atom_ptr); pair_ptr; pair_ptr = PAIR_NEXT(system,pair_ptr))
 				potential += pair_ptr->rd_energy;
 
 	return(potential);
@@ -0,0 +1,408 @@
+/*
+
+Space Research Group
+Department of Chemistry
+University of South Florida
+
+Smooth particle mesh ewald (Essmann et al., J. Chem. Phys. 103, 8577 (1995)) for the
+reciprocal space sum. The charges are spread onto a grid along the (triclinic) cell
+axes with cardinal B-splines and the structure factors come from a mixed-radix FFT,
+so no external FFT library is needed.
+
+*/
+
+#include <mc.h>
+
+/* smallest 2,3,5-smooth grid size that is at least n */
+static int spme_grid_size(int n) {
+
+	int m;
+
+	for(;; n++) {
+		for(m = n; !(m % 2); m /= 2);
+		for(; !(m % 3); m /= 3);
+		for(; !(m % 5); m /= 5);
+		if(m == 1) return n;
+	}
+}
+
+/* radices for the FFT of length n, ending with 0 */
+static int *spme_factors(int n) {
+
+	int p, i = 0, *factors;
+
+	factors = calloc(32, sizeof(int));
+	memnullcheck(factors, 32*sizeof(int), __LINE__-1, __FILE__);
+
+	for(p = 2; n > 1; p++)
+		while(!(n % p)) {
+			factors[i++] = p;
+			n /= p;
+		}
+
+	return factors;
+}
+
+/* recursive decimation-in-time FFT of n interleaved complex values (in is strided, out is contiguous) */
+/* W_n^j is stored as roots[j*rstride] in the table for the full length */
+static void spme_fft_rec(int n, int istride, double *in, double *out, int *factors, double *roots, int rstride, double *butterfly) {
+
+	int p, m, r, q, k, j;
+	double re, im;
+
+	if(n == 1) {
+		out[0] = in[0];
+		out[1] = in[1];
+		return;
+	}
+
+	p = factors[0];
+	m = n/p;
+
+	/* transform each of the p decimated sequences */
+	for(r = 0; r < p; r++)
+		spme_fft_rec(m, istride*p, in + 2*r*istride, out + 2*r*m, factors + 1, roots, rstride*p, butterfly);
+
+	/* combine them with radix-p butterflies */
+	for(k = 0; k < m; k++) {
+
+		for(r = 0; r < p; r++) {
+			butterfly[2*r] = out[2*(r*m + k)];
+			butterfly[2*r+1] = out[2*(r*m + k) + 1];
+		}
+
+		for(q = 0; q < p; q++) {
+			re = 0; im = 0;
+			for(r = 0; r < p; r++) {
+				j = ((r*(k + q*m)) % n)*rstride;
+				re += butterfly[2*r]*roots[2*j] - butterfly[2*r+1]*roots[2*j+1];
+				im += butterfly[2*r]*roots[2*j+1] + butterfly[2*r+1]*roots[2*j];
+			}
+			out[2*(k + q*m)] = re;
+			out[2*(k + q*m) + 1] = im;
+		}
+	}
+
+	return;
+}
+
+/* in-place 3D FFT of the charge grid, one axis at a time */
+static void spme_fft3d(spme_t *spme) {
+
+	int a, i, j, l, n, stride, outer, inner;
+	int *npts = spme->npts;
+	double *grid = spme->grid;
+
+	for(a = 0; a < 3; a++) {
+
+		n = npts[a];
+		/* grid is stored with the last axis fastest */
+		stride = (a == 0) ? npts[1]*npts[2] : ((a == 1) ? npts[2] : 1);
+		outer = (a == 0) ? 1 : ((a == 1) ? npts[0] : npts[0]*npts[1]);
+		inner = stride;
+
+		for(i = 0; i < outer; i++) {
+			for(j = 0; j < inner; j++) {
+
+				for(l = 0; l < n; l++) {
+					spme->line[2*l] = grid[2*(i*n*stride + l*stride + j)];
+					spme->line[2*l+1] = grid[2*(i*n*stride + l*stride + j) + 1];
+				}
+
+				spme_fft_rec(n, 1, spme->line, spme->line_fft, spme->factors[a], spme->roots[a], 1, spme->butterfly);
+
+				for(l = 0; l < n; l++) {
+					grid[2*(i*n*stride + l*stride + j)] = spme->line_fft[2*l];
+					grid[2*(i*n*stride + l*stride + j) + 1] = spme->line_fft[2*l+1];
+				}
+			}
+		}
+	}
+
+	return;
+}
+
+/* cardinal B-spline weights, theta[j] = M_n(fr + n - 1 - j) */
+static void spme_bspline(int order, double fr, double *theta) {
+
+	int k, l;
+	double div;
+
+	theta[order-1] = 0;
+	theta[1] = fr;
+	theta[0] = 1.0 - fr;
+
+	for(k = 3; k <= order; k++) {
+		div = 1.0/(double)(k - 1);
+		theta[k-1] = div*fr*theta[k-2];
+		for(l = 1; l <= (k - 2); l++)
+			theta[k-l-1] = div*((fr + l)*theta[k-l-2] + (k - l - fr)*theta[k-l-1]);
+		theta[0] = div*(1.0 - fr)*theta[0];
+	}
+
+	return;
+}
+
+/* |b(m)|^2 along one axis, the euler exponential spline moduli */
+static void spme_bspline_moduli(int order, int n, double *bsp_mod) {
+
+	int m, k;
+	double theta[SPME_MAX_ORDER], re, im, arg;
+
+	spme_bspline(order, 0.0, theta);
+
+	for(m = 0; m < n; m++) {
+		re = 0; im = 0;
+		for(k = 0; k <= (order - 2); k++) {
+			arg = 2.0*M_PI*m*k/n;
+			re += theta[order-2-k]*cos(arg); //M_n(k+1)
+			im += theta[order-2-k]*sin(arg);
+		}
+		bsp_mod[m] = re*re + im*im;
+	}
+
+	/* odd orders vanish at the nyquist frequency, interpolate over it */
+	for(m = 0; m < n; m++)
+		if(bsp_mod[m] < 1.0e-7)
+			bsp_mod[m] = 0.5*(bsp_mod[(m - 1 + n) % n] + bsp_mod[(m + 1) % n]);
+
+	return;
+}
+
+/* (re)build the influence function, which depends on the volume and alpha */
+static void spme_influence(system_t *system, spme_t *spme) {
+
+	int i[3], m[3], p, q, n;
+	double k[3], k_squared;
+	double alpha = system->ewald_alpha;
+
+	for(i[0] = 0, n = 0; i[0] < spme->npts[0]; i[0]++) {
+		for(i[1] = 0; i[1] < spme->npts[1]; i[1]++) {
+			for(i[2] = 0; i[2] < spme->npts[2]; i[2]++, n++) {
+
+				for(p = 0; p < 3; p++)
+					m[p] = (i[p] <= spme->npts[p]/2) ? i[p] : (i[p] - spme->npts[p]);
+
+				if(!m[0] && !m[1] && !m[2]) {
+					spme->influence[n] = 0;
+					continue;
+				}
+
+				/* same reciprocal lattice vectors as coulombic_reciprocal() */
+				for(p = 0; p < 3; p++)
+					for(q = 0, k[p] = 0; q < 3; q++)
+						k[p] += 2.0*M_PI*system->pbc->reciprocal_basis[p][q]*m[q];
+				k_squared = dddotprod(k,k);
+
+				spme->influence[n] = 2.0*M_PI/system->pbc->volume*exp(-k_squared/(4.0*alpha*alpha))/k_squared
+					/(spme->bsp_mod[0][i[0]]*spme->bsp_mod[1][i[1]]*spme->bsp_mod[2][i[2]]);
+			}
+		}
+	}
+
+	spme->volume = system->pbc->volume;
+	spme->alpha = alpha;
+
+	return;
+}
+
+static spme_t *spme_setup(system_t *system) {
+
+	int a, j, n, nmax;
+	double length;
+	spme_t *spme;
+	char linebuf[MAXLINE];
+
+	spme = calloc(1, sizeof(spme_t));
+	memnullcheck(spme, sizeof(spme_t), __LINE__-1, __FILE__);
+	system->spme = spme;
+
+	spme->order = system->ewald_spme_order;
+
+	for(a = 0, nmax = 0; a < 3; a++) {
+		length = sqrt(dddotprod(system->pbc->basis[a], system->pbc->basis[a]));
+		n = (int)ceil(length/system->ewald_spme_spacing);
+		if(n < spme->order) n = spme->order;
+		spme->npts[a] = spme_grid_size(n);
+		if(spme->npts[a] > nmax) nmax = spme->npts[a];
+
+		spme->factors[a] = spme_factors(spme->npts[a]);
+
+		spme->roots[a] = calloc(2*spme->npts[a], sizeof(double));
+		memnullcheck(spme->roots[a], 2*spme->npts[a]*sizeof(double), __LINE__-1, __FILE__);
+		for(j = 0; j < spme->npts[a]; j++) {
+			spme->roots[a][2*j] = cos(2.0*M_PI*j/spme->npts[a]);
+			spme->roots[a][2*j+1] = sin(2.0*M_PI*j/spme->npts[a]);
+		}
+
+		spme->bsp_mod[a] = calloc(spme->npts[a], sizeof(double));
+		memnullcheck(spme->bsp_mod[a], spme->npts[a]*sizeof(double), __LINE__-1, __FILE__);
+		spme_bspline_moduli(spme->order, spme->npts[a], spme->bsp_mod[a]);
+	}
+	spme->ntotal = spme->npts[0]*spme->npts[1]*spme->npts[2];
+
+	spme->grid = calloc(2*spme->ntotal, sizeof(double));
+	memnullcheck(spme->grid, 2*spme->ntotal*sizeof(double), __LINE__-1, __FILE__);
+	spme->influence = calloc(spme->ntotal, sizeof(double));
+	memnullcheck(spme->influence, spme->ntotal*sizeof(double), __LINE__-1, __FILE__);
+	spme->line = calloc(2*nmax, sizeof(double));
+	memnullcheck(spme->line, 2*nmax*sizeof(double), __LINE__-1, __FILE__);
+	spme->line_fft = calloc(2*nmax, sizeof(double));
+	memnullcheck(spme->line_fft, 2*nmax*sizeof(double), __LINE__-1, __FILE__);
+	spme->butterfly = calloc(2*nmax, sizeof(double));
+	memnullcheck(spme->butterfly, 2*nmax*sizeof(double), __LINE__-1, __FILE__);
+
+	sprintf(linebuf, "SPME: %d x %d x %d charge grid with order %d B-splines\n", spme->npts[0], spme->npts[1], spme->npts[2], spme->order);
+	output(linebuf);
+
+	return spme;
+}
+
+/* spread the sorbate charges onto the grid, transform, and sum against the influence function */
+static double spme_energy(system_t *system, spme_t *spme) {
+
+	molecule_t *molecule_ptr;
+	atom_t *atom_ptr;
+	int a, p, n, j0, j1, j2, base[3], idx[3][SPME_MAX_ORDER];
+	int order = spme->order, *npts = spme->npts;
+	double s, u, theta[3][SPME_MAX_ORDER], w01;
+	double potential = 0;
+
+	memset(spme->grid, 0, 2*spme->ntotal*sizeof(double));
+
+	for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next) {
+		for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
+
+			if(atom_ptr->frozen) continue; //skip frozen
+			if(atom_ptr->charge == 0.0) continue; //skip if no charge
+
+			for(a = 0; a < 3; a++) {
+				/* scaled fractional coordinate, as in minimum_image() */
+				for(p = 0, s = 0; p < 3; p++)
+					s += system->pbc->reciprocal_basis[p][a]*atom_ptr->pos[p];
+				u = (s - floor(s))*npts[a];
+				base[a] = (int)floor(u);
+				spme_bspline(order, u - base[a], theta[a]);
+				for(n = 0; n < order; n++)
+					idx[a][n] = ((base[a] - order + 1 + n) % npts[a] + npts[a]) % npts[a];
+			}
+
+			for(j0 = 0; j0 < order; j0++) {
+				for(j1 = 0; j1 < order; j1++) {
+					w01 = atom_ptr->charge*theta[0][j0]*theta[1][j1];
+					for(j2 = 0; j2 < order; j2++)
+						spme->grid[2*((idx[0][j0]*npts[1] + idx[1][j1])*npts[2] + idx[2][j2])] += w01*theta[2][j2];
+				}
+			}
+
+		} /* atom */
+	} /* molecule */
+
+	spme_fft3d(spme);
+
+	for(n = 0; n < spme->ntotal; n++)
+		potential += spme->influence[n]*(spme->grid[2*n]*spme->grid[2*n] + spme->grid[2*n+1]*spme->grid[2*n+1]);
+
+	return(potential);
+}
+
+/* compare against the ewald k-sum for the starting configuration */
+static void spme_accuracy(system_t *system, spme_t *spme) {
+
+	struct timeval t0, t1, t2;
+	double e_spme, e_ewald;
+	char linebuf[MAXLINE];
+
+	gettimeofday(&t0, NULL);
+	e_spme = spme_energy(system, spme);
+	gettimeofday(&t1, NULL);
+	e_ewald = coulombic_reciprocal(system);
+	gettimeofday(&t2, NULL);
+
+	sprintf(linebuf, "SPME: reciprocal energy %.6f K vs. ewald k-sum %.6f K (kmax %d), difference %.3e K\n", e_spme, e_ewald, system->ewald_kmax, e_spme - e_ewald);
+	output(linebuf);
+	sprintf(linebuf, "SPME: evaluation took %.3f ms vs. %.3f ms for the k-sum\n",
+		(double)((t1.tv_sec - t0.tv_sec)*1e6 + (t1.tv_usec - t0.tv_usec))/1000.0,
+		(double)((t2.tv_sec - t1.tv_sec)*1e6 + (t2.tv_usec - t1.tv_usec))/1000.0);
+	output(linebuf);
+
+	return;
+}
+
+/* fourier space sum by smooth particle mesh ewald */
+double coulombic_reciprocal_spme(system_t *system) {
+
+	spme_t *spme = system->spme;
+	int first = 0;
+
+	if(!spme) {
+		spme = spme_setup(system);
+		first = 1;
+	}
+
+	if((spme->volume != system->pbc->volume) || (spme->alpha != system->ewald_alpha))
+		spme_influence(system, spme);
+
+	if(first) spme_accuracy(system, spme);
+
+	spme->energy = spme_energy(system, spme);
+	spme->valid = 1;
+
+	return(spme->energy);
+}
+
+/* change in the fourier space sum relative to the checkpointed configuration */
+double coulombic_reciprocal_spme_delta(system_t *system) {
+
+	double potential;
+
+	potential = coulombic_reciprocal_spme(system);
+
+	if(!system->spme->acc_valid) {
+		error("SPME: no reciprocal energy was checkpointed for the incremental energy\n");
+		die(-1);
+	}
+
+	return(potential - system->spme->acc_energy);
+}
+
+void spme_checkpoint(system_t *system) {
+
+	if(!system->spme) return;
+
+	system->spme->acc_energy = system->spme->energy;
+	system->spme->acc_valid = system->spme->valid;
+
+	return;
+}
+
+void spme_restore(system_t *system) {
+
+	if(!system->spme) return;
+
+	system->spme->energy = system->spme->acc_energy;
+	system->spme->valid = system->spme->acc_valid;
+
+	return;
+}
+
+void free_spme(system_t *system) {
+
+	int a;
+	spme_t *spme = system->spme;
+
+	for(a = 0; a < 3; a++) {
+		free(spme->factors[a]);
+		free(spme->roots[a]);
+		free(spme->bsp_mod[a]);
+	}
+	free(spme->grid);
+	free(spme->influence);
+	free(spme->line);
+	free(spme->line_fft);
+	free(spme->butterfly);
+	free(spme);
+	system->spme = NULL;
+
+	return;
+}
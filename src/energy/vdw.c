@@ -65,12 +65,44 @@ void free_mtx ( struct mtx * M ) {
 #ifdef VDW
 //prototype for dsyev (LAPACK)
 extern void dsyev_(char *, char *, int *, double *, int *, double *, double *, int *, int *);
+//and for dsyevd and dsyevr (LAPACK), the cdvdw_eigensolver alternatives
+extern void dsyevd_(char *, char *, int *, double *, int *, double *, double *, int *, int *, int *, int *);
+extern void dsyevr_(char *, char *, char *, int *, double *, int *, double *, double *, int *, int *, double *, int *, double *, double *, int *, int *, double *, int *, int *, int *, int *);
+//and for dpotrf (LAPACK) and dgemm (BLAS), used by cdvdw_quadrature
+extern void dpotrf_(char *, int *, double *, int *, int *);
+extern void dgemm_(char *, char *, int *, int *, int *, double *, double *, int *, double *, int *, double *, double *, int *);
+extern void dsyrk_(char *, char *, int *, int *, double *, double *, int *, double *, double *, int *);
 #else
 void dsyev_
 (char * a, char *b, int * c, double * d, int * e, double * f, double * g, int * h, int * i) {
 	error("ERROR: Not compiled with Linear Algebra VDW.\n");
 	die(-1);
 }
+void dsyevd_
+(char * a, char * b, int * c, double * d, int * e, double * f, double * g, int * h, int * i, int * j, int * k) {
+	error("ERROR: Not compiled with Linear Algebra VDW.\n");
+	die(-1);
+}
+void dsyevr_
+(char * a, char * b, char * c, int * d, double * e, int * f, double * g, double * h, int * i, int * j, double * k, int * l, double * m, double * n, int * o, int * p, double * q, int * r, int * s, int * t, int * u) {
+	error("ERROR: Not compiled with Linear Algebra VDW.\n");
+	die(-1);
+}
+void dpotrf_
+(char * a, int * b, double * c, int * d, int * e) {
+	error("ERROR: Not compiled with Linear Algebra VDW.\n");
+	die(-1);
+}
+void dgemm_
+(char * a, char * b, int * c, int * d, int * e, double * f, double * g, int * h, double * i, int * j, double * k, double * l, int * m) {
+	error("ERROR: Not compiled with Linear Algebra VDW.\n");
+	die(-1);
+}
+void dsyrk_
+(char * a, char * b, int * c, int * d, double * e, double * f, int * g, double * h, double * i, int * j) {
+	error("ERROR: Not compiled with Linear Algebra VDW.\n");
+	die(-1);
+}
 #endif
 
 //can be used to test shit --- not actually used in any of the code
@@ -135,39 +167,98 @@ void printevects ( struct mtx * M ) {
 	printf("%%vdw=== End Eigenvectors ===\n");
 }
 
+//the LAPACK workspace, allocated on first use
+static vdw_lapack_t * vdw_lapack_workspace ( system_t * system ) {
+	if ( system->vdw_lapack == NULL ) {
+		system->vdw_lapack = calloc(1,sizeof(vdw_lapack_t));
+		checknull(system->vdw_lapack,"vdw_lapack_t * vdw_lapack",sizeof(vdw_lapack_t));
+	}
+	return system->vdw_lapack;
+}
+
+void free_vdw_lapack ( vdw_lapack_t * ws ) {
+	if ( ws == NULL ) return;
+	free(ws->work);
+	free(ws->iwork);
+	free(ws->eigvals);
+	free(ws);
+	return;
+}
+
+//seconds since *t, which is then reset to now
+static double vdw_lap ( struct timeval * t ) {
+	struct timeval now;
+	double dt;
+
+	gettimeofday(&now, NULL);
+	dt = (double)(now.tv_sec - t->tv_sec) + 1.0e-6*(double)(now.tv_usec - t->tv_usec);
+	*t = now;
+	return dt;
+}
+
 /* LAPACK using 1D arrays for storing matricies.
 	/ 0  3  6 \
 	| 1  4  7 |		= 	[ 0 1 2 3 4 5 6 7 8 ]
 	\ 2  5  8 /									*/
-double * lapack_diag ( struct mtx * M, int jobtype ) {
+//the eigenvalues returned live in system->vdw_lapack, and are overwritten by the next call
+double * lapack_diag ( system_t * system, struct mtx * M, int jobtype, int solver ) {
 	char job; //job type
 	char uplo='L'; //operate on lower triagle
-	double * work; //working space for dsyev
-	int lwork; //size of work array
+	char range='A'; //all eigenvalues (dsyevr)
+	vdw_lapack_t * ws = vdw_lapack_workspace(system); //work arrays kept from the last call
+	double query=0, dummy=0, abstol=0; //dsyevr chooses its own tolerance for abstol <= 0
+	int iquery=0, idummy=0, isuppz[2], m;
+	int lwork, liwork; //sizes of the work arrays
 	int rval=0; //returned from dsyev_
-	double * eigvals;
 	char linebuf[MAXLINE];
 
-	//eigenvectors or no?
-	if ( jobtype == 2 ) job='V';
+	//eigenvectors or no? dsyevd and dsyevr are only used for eigenvalues
+	if ( jobtype == 2 ) {
+		job='V';
+		solver=CDVDW_DSYEV;
+	}
 	else job = 'N';
 
 	if ( M->dim == 0 ) return NULL;
 
-	//allocate eigenvalues array
-	eigvals = malloc(M->dim*sizeof(double));
-	checknull(eigvals,"double * eigvals",M->dim*sizeof(double));
-	//optimize the size of work array
-	lwork = -1;
-	work = malloc(sizeof(double));
-	checknull(work,"double * work",sizeof(double));
-	dsyev_(&job, &uplo, &(M->dim), M->val, &(M->dim), eigvals, work, &lwork, &rval);
-	//now optimize work array size is stored as work[0]
-	lwork=(int)work[0];
-	work = realloc(work,lwork*sizeof(double));
-	checknull(work,"double * work",lwork*sizeof(double));
+	//grow the eigenvalues array
+	if ( M->dim > ws->neigvals ) {
+		ws->eigvals = realloc(ws->eigvals,M->dim*sizeof(double));
+		checknull(ws->eigvals,"double * eigvals",M->dim*sizeof(double));
+		ws->neigvals = M->dim;
+	}
+
+	//the optimal work sizes grow with dim, so only ask for a matrix larger than any asked about before
+	if ( M->dim > ws->sized[solver][jobtype==2] ) {
+		lwork = liwork = -1;
+		if ( solver == CDVDW_DSYEVD )
+			dsyevd_(&job, &uplo, &(M->dim), M->val, &(M->dim), ws->eigvals, &query, &lwork, &iquery, &liwork, &rval);
+		else if ( solver == CDVDW_DSYEVR )
+			dsyevr_(&job, &range, &uplo, &(M->dim), M->val, &(M->dim), &dummy, &dummy, &idummy, &idummy, &abstol, &m, ws->eigvals, &dummy, &(M->dim), isuppz, &query, &lwork, &iquery, &liwork, &rval);
+		else
+			dsyev_(&job, &uplo, &(M->dim), M->val, &(M->dim), ws->eigvals, &query, &lwork, &rval);
+		//now optimize work array size is stored as query
+		lwork=(int)query;
+		if ( lwork > ws->lwork ) {
+			ws->work = realloc(ws->work,lwork*sizeof(double));
+			checknull(ws->work,"double * work",lwork*sizeof(double));
+			ws->lwork = lwork;
+		}
+		if ( iquery > ws->liwork ) {
+			ws->iwork = realloc(ws->iwork,iquery*sizeof(int));
+			checknull(ws->iwork,"int * iwork",iquery*sizeof(int));
+			ws->liwork = iquery;
+		}
+		ws->sized[solver][jobtype==2] = M->dim;
+	}
+
 	//diagonalize
-	dsyev_(&job, &uplo, &(M->dim), M->val, &(M->dim), eigvals, work, &lwork, &rval);
+	if ( solver == CDVDW_DSYEVD )
+		dsyevd_(&job, &uplo, &(M->dim), M->val, &(M->dim), ws->eigvals, ws->work, &(ws->lwork), ws->iwork, &(ws->liwork), &rval);
+	else if ( solver == CDVDW_DSYEVR )
+		dsyevr_(&job, &range, &uplo, &(M->dim), M->val, &(M->dim), &dummy, &dummy, &idummy, &idummy, &abstol, &m, ws->eigvals, &dummy, &(M->dim), isuppz, ws->work, &(ws->lwork), ws->iwork, &(ws->liwork), &rval);
+	else
+		dsyev_(&job, &uplo, &(M->dim), M->val, &(M->dim), ws->eigvals, ws->work, &(ws->lwork), &rval);
 
 	if ( rval != 0 ) {
 		sprintf(linebuf,"error: LAPACK: dsyev returned error: %d\n", rval);
@@ -175,9 +266,7 @@ double * lapack_diag ( struct mtx * M, int jobtype ) {
 		die(-1);
 	}
 
-	free(work);
-
-	return eigvals;
+	return ws->eigvals;
 }
 
 /* not needed unless T >> 300 
@@ -202,42 +291,79 @@ double eigen2energy ( double * eigvals, int dim, double temperature ) {
 	return rval;
 }
 
-//calculate energies for isolated molecules
-//if we don't know it, calculate it and save the value
-double calc_e_iso ( system_t * system, double * sqrtKinv, molecule_t * mptr ) {
-	int nstart, nsize; // , curr_dimM;  (unused variable)
+//calculate the energy of an isolated molecule, with atoms nstart..nstart+nsize in the A matrix
+double calc_e_iso ( system_t * system, double * sqrtKinv, int nstart, int nsize ) {
 	double e_iso; //total vdw energy of isolated molecules
 	struct mtx * Cm_iso; //matrix Cm_isolated
 	double * eigvals; //eigenvalues of Cm_cm
-	molecule_t * molecule_ptr;
-	atom_t * atom_ptr;
 
-	nstart=nsize=0; //loop through each individual molecule
-	for ( molecule_ptr = system->molecules; molecule_ptr; molecule_ptr=molecule_ptr->next ) {
-		if ( molecule_ptr != mptr ) {  //count atoms then skip to next molecule
-			for ( atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next ) nstart++;
-			continue;
-		}
+	//build matrix for calculation of vdw energy of isolated molecule
+	Cm_iso = build_M(3*(nsize), 3*nstart, system->A_matrix, sqrtKinv);
+	//diagonalize M and extract eigenvales -> calculate energy
+	eigvals=lapack_diag(system,Cm_iso,1,CDVDW_DSYEV); //no eigenvectors
+	e_iso=eigen2energy(eigvals,Cm_iso->dim,system->temperature);
 
-		//now that we've found the molecule of interest, count natoms, and calc energy
-		for ( atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next ) nsize++;
+	//free memory
+	free_mtx(Cm_iso);
 
-		//build matrix for calculation of vdw energy of isolated molecule
-		Cm_iso = build_M(3*(nsize), 3*nstart, system->A_matrix, sqrtKinv);
-		//diagonalize M and extract eigenvales -> calculate energy
-		eigvals=lapack_diag(Cm_iso,1); //no eigenvectors
-		e_iso=eigen2energy(eigvals,Cm_iso->dim,system->temperature);
+	//convert a.u. -> s^-1 -> K
+	return e_iso * au2invsec * halfHBAR ;
+}
 
-		//free memory
-		free(eigvals);
-		free_mtx(Cm_iso);
+//bucket of a molecule type in the e_iso table (FNV-1a over its name and size)
+static unsigned int vdw_eiso_hash ( char * mtype, int natoms ) {
+	unsigned int h = 2166136261u;
 
-		//convert a.u. -> s^-1 -> K
-		return e_iso * au2invsec * halfHBAR ;
-	}	
+	for ( ; *mtype; mtype++ ) {
+		h ^= (unsigned char)(*mtype);
+		h *= 16777619u;
+	}
+	h ^= (unsigned int)natoms;
+	h *= 16777619u;
 
-	//unmatched molecule
-	return NAN; //we should never get here
+	return h % VDW_EISO_BUCKETS;
+}
+
+//key of a molecule: alpha and omega of each atom, then its distance to the centroid and to the next atom
+//(invariant under the rigid moves, and linear in the size of the molecule, unlike all of its distances;
+//the cell isn't part of it, sum_eiso_vdw() empties the table instead when the cell changes)
+static void vdw_eiso_key ( molecule_t * mp, int natoms, double * key ) {
+	atom_t * ap;
+	int i = 0, p;
+	double c[3] = {0, 0, 0}, r2, d;
+
+	for ( ap = mp->atoms; ap; ap = ap->next ) {
+		key[i++] = ap->polarizability;
+		key[i++] = ap->omega;
+		for ( p=0; p<3; p++ ) c[p] += ap->pos[p]/natoms;
+	}
+	for ( ap = mp->atoms; ap; ap = ap->next ) {
+		for ( r2=0, p=0; p<3; p++ ) {
+			d = ap->pos[p] - c[p];
+			r2 += d*d;
+		}
+		key[i++] = sqrt(r2);
+		for ( r2=0, p=0; ap->next && p<3; p++ ) {
+			d = ap->pos[p] - ap->next->pos[p];
+			r2 += d*d;
+		}
+		key[i++] = sqrt(r2);
+	}
+
+	return;
+}
+
+//parameters must match exactly, distances within VDW_EISO_TOLERANCE (rotations leave round-off in them)
+static int vdw_eiso_match ( vdw_t * vp, char * mtype, int natoms, double * key ) {
+	int i;
+
+	if ( vp->natoms != natoms || strncmp(vp->mtype,mtype,MAXLINE) ) return 0;
+	for ( i=0; i<2*natoms; i++ )
+		if ( vp->key[i] != key[i] ) return 0;
+	for ( ; i<4*natoms; i++ )
+		if ( fabs(vp->key[i] - key[i]) > VDW_EISO_TOLERANCE ) return 0;
+
+	return 1;
 }
 
 //go through each molecule and determine the VDW energy associated with each isolated molecule
@@ -245,51 +371,68 @@ double sum_eiso_vdw ( system_t * system, double * sqrtKinv ) {
 
 	char linebuf[MAXLINE];
 	double e_iso = 0;
+	double * key = NULL; //key of the current molecule
+	int nkey, maxkey = 0;
+	unsigned int h;
 	molecule_t * mp;
-	// atom_t * ap;  (unused variable)
+	atom_t * ap;
 	vdw_t * vp;
-	vdw_t * vpscan;
-
-	//loop through molecules. if not known, calculate, store and count. otherwise just count.
-	for ( mp = system->molecules; mp; mp=mp->next ) {
-		for ( vp = system->vdw_eiso_info; vp != NULL; vp=vp->next ) { //loop through all vp's
-			if ( strncmp(vp->mtype,mp->moleculetype,MAXLINE) == 0 ) {
-					e_iso += vp->energy; //count energy
-					break; //break out of vp loop. the current molecule is accounted for now. go to the next molecule
-			}
-			else continue; //not a match, check the next vp
-		} //vp loop
-
-		if ( vp == NULL ) { //if the molecule was unmatched, we need to grow the list
-			// end of vp list and we haven't matched yet -> grow vdw_eiso_info
-			// scan to the last non-NULL element
-			if ( system->vdw_eiso_info == NULL ) {
-				system->vdw_eiso_info = calloc(1,sizeof(vdw_t)); //allocate space
-				checknull(system->vdw_eiso_info,"calloc vdw_t * vdw_eiso_info",sizeof(vdw_t));
-				vpscan = system->vdw_eiso_info; //set scan pointer
-			} else {
-				for ( vpscan = system->vdw_eiso_info; vpscan->next != NULL; vpscan=vpscan->next );
-				vpscan->next = calloc(1,sizeof(vdw_t)); //allocate space
-				checknull(vpscan->next,"calloc vdw_t * vpscan->next", sizeof(vdw_t));
-				vpscan = vpscan->next;
-			} //done scanning and malloc'ing
-		
-			//set values
-			strncpy(vpscan->mtype,mp->moleculetype,MAXLINE); //assign moleculetype
-			vpscan->energy = calc_e_iso(system,sqrtKinv,mp); //assign energy
-			if ( isfinite(vpscan->energy) == 0 ) { //if nan, then calc_e_iso failed
+	int nstart, nsize; //atom offset and size of the current molecule
+
+	//the intramolecular dipole tensors are minimum-imaged, so the energies only hold for the cell they were
+	//computed in: a volume change (NPT) empties the table
+	if ( system->vdw_eiso_info && memcmp(system->vdw_eiso_basis,system->pbc->basis,sizeof(system->vdw_eiso_basis)) ) {
+		free_vdw_eiso(system->vdw_eiso_info);
+		system->vdw_eiso_info = NULL;
+	}
+
+	//the table is made on the first call, and lives until cleanup
+	if ( system->vdw_eiso_info == NULL ) {
+		system->vdw_eiso_info = calloc(VDW_EISO_BUCKETS,sizeof(vdw_t *));
+		checknull(system->vdw_eiso_info,"calloc vdw_t ** vdw_eiso_info",VDW_EISO_BUCKETS*sizeof(vdw_t *));
+		memcpy(system->vdw_eiso_basis,system->pbc->basis,sizeof(system->vdw_eiso_basis));
+	}
+
+	//look each molecule up by type, size, parameters and internal geometry. if not known, calculate, store and count. otherwise just count.
+	//every unknown molecule is diagonalized in this one pass, at the offset the loop is already at
+	for ( mp = system->molecules, nstart = 0; mp; mp=mp->next, nstart += nsize ) {
+		for ( ap = mp->atoms, nsize = 0; ap; ap = ap->next ) nsize++;
+		nkey = 4*nsize;
+		if ( nkey > maxkey ) {
+			key = realloc(key,nkey*sizeof(double));
+			checknull(key,"double * key",nkey*sizeof(double));
+			maxkey = nkey;
+		}
+		vdw_eiso_key(mp,nsize,key);
+
+		h = vdw_eiso_hash(mp->moleculetype,nsize);
+		for ( vp = system->vdw_eiso_info[h]; vp; vp=vp->next )
+			if ( vdw_eiso_match(vp,mp->moleculetype,nsize,key) ) break;
+
+		if ( vp == NULL ) { //if the molecule was unmatched, calculate it and put it at the head of its chain
+			vp = calloc(1,sizeof(vdw_t)); //allocate space
+			checknull(vp,"calloc vdw_t * vp",sizeof(vdw_t));
+			strncpy(vp->mtype,mp->moleculetype,MAXLINE); //assign moleculetype
+			vp->natoms = nsize;
+			vp->key = malloc(nkey*sizeof(double));
+			checknull(vp->key,"double * vp->key",nkey*sizeof(double));
+			memcpy(vp->key,key,nkey*sizeof(double));
+			vp->energy = calc_e_iso(system,sqrtKinv,nstart,nsize); //assign energy
+			if ( isfinite(vp->energy) == 0 ) { //if nan, then calc_e_iso failed
 				sprintf(linebuf,"VDW: Problem in calc_e_iso.\n");
 				output(linebuf);
 				die(-1);
 			}
-			//otherwise count the energy and move to the next molecule
-			e_iso += vpscan->energy;
-
+			vp->next = system->vdw_eiso_info[h];
+			system->vdw_eiso_info[h] = vp;
 		} //vp==NULL
+
+		e_iso += vp->energy; //count energy
 	} //mp loop	
 
-	////all of this logic is actually really bad if we're doing surface fitting, since omega will change... :-(
-	//free everything so we can recalc next step
+	free(key);
+
+	//surface fitting changes omega and alpha on every trial; the keys would catch that, but the table would keep them all
 	if ( system->ensemble == ENSEMBLE_SURF_FIT )  {
 		free_vdw_eiso(system->vdw_eiso_info);
 		system->vdw_eiso_info = NULL;
@@ -391,7 +534,7 @@ double e2body(system_t * system, atom_t * atom, pair_t * pair, double r) {
 	M->val[10]=M->val[17]=M->val[25]=M->val[32]=
 		(atom->omega)*(pair->atom->omega)*sqrt(atom->polarizability*pair->atom->polarizability)*Tyy;
 
-	eigvals=lapack_diag(M,1);
+	eigvals=lapack_diag(system,M,1,CDVDW_DSYEV);
 	energy = eigen2energy(eigvals, 6, system->temperature);
 
 	//subtract energy of atoms at infinity
@@ -400,7 +543,6 @@ double e2body(system_t * system, atom_t * atom, pair_t * pair, double r) {
 //	energy -= 3*wtanh(pair->atom->omega, system->temperature);
 	energy -= 3*pair->atom->omega;
 
-	free(eigvals);
 	free_mtx(M);
 
   return energy * au2invsec * halfHBAR;
@@ -555,40 +697,275 @@ double twobody(system_t * system) {
 }
 		
 
+/* Frequency quadrature for the many-body energy (cdvdw_quadrature).
+	With sum_i sqrt(l_i) = (1/pi) int_0^inf sum_i ln(1 + l_i/u^2) du, the many-body energy
+	tr C^1/2 - tr D^1/2 (D the isolated molecule blocks of C) is
+		(1/pi) int_0^inf [ ln det(C + u^2) - ln det(D + u^2) ] du.
+	Splitting C into its frozen block F, the mobile block S and their coupling B,
+		ln det(C + u^2) = ln det(F + u^2) + ln det(S + u^2 - B^T (F + u^2)^-1 B)
+	and F only has to be diagonalized once (F = Q L Q^T) for as long as the frozen sites hold
+	still. Each energy then costs one product Q^T B and a small cholesky factorization per
+	quadrature point, instead of diagonalizing all of C.						*/
+
+//gauss-legendre nodes and weights on [-1,1] (numerical recipes gauleg)
+static void vdw_gauss_legendre ( int n, double * x, double * w ) {
+	int i, j, m = (n+1)/2;
+	double z, z1, p1, p2, p3, pp;
+
+	for ( i=0; i<m; i++ ) {
+		z = cos(M_PI*(i+0.75)/(n+0.5));
+		do {
+			p1 = 1.0; p2 = 0.0;
+			for ( j=0; j<n; j++ ) {
+				p3 = p2; p2 = p1;
+				p1 = ((2.0*j+1.0)*z*p2 - j*p3)/(j+1);
+			}
+			pp = n*(z*p1-p2)/(z*z-1.0);
+			z1 = z;
+			z = z1 - p1/pp;
+		} while ( fabs(z-z1) > 3.0e-14 );
+		x[i] = -z; x[n-1-i] = z;
+		w[i] = w[n-1-i] = 2.0/((1.0-z*z)*pp*pp);
+	}
+
+	return;
+}
+
+//ln det of the n x n (column-major, lower triangle) positive definite matrix M, destroyed; NAN if it isn't
+static double vdw_logdet ( int n, double * M, int ld ) {
+	char uplo='L';
+	int i, info=0;
+	double rval=0;
+
+	if ( n == 0 ) return 0;
+	dpotrf_(&uplo, &n, M, &ld, &info);
+	if ( info != 0 ) return NAN;
+	for ( i=0; i<n; i++ ) rval += 2.0*log(M[i+i*ld]);
+
+	return rval;
+}
+
+void free_vdw_frozen ( vdw_frozen_t * vf ) {
+	if ( vf == NULL ) return;
+	free(vf->key);
+	free(vf->evals);
+	free(vf->evects);
+	free(vf);
+	return;
+}
+
+//diagonalize the frozen block F (rows fidx), unless the frozen sites are the ones it was built from
+static vdw_frozen_t * vdw_frozen_setup ( system_t * system, double * sqrtKinv, int * fidx, int * fmol, int nf ) {
+	int a, b, i, m, nm;
+	double ** Am = system->A_matrix;
+	double * key, * eigvals;
+	struct mtx * Fc;
+	vdw_frozen_t * vf = system->vdw_frozen;
+
+	key = malloc(4*nf*sizeof(double));
+	checknull(key,"double * key",4*nf*sizeof(double));
+	for ( a=0; a<nf; a++ ) {
+		key[4*a] = sqrtKinv[fidx[a]];
+		memcpy(key+4*a+1, system->atom_array[fidx[a]/3]->pos, 3*sizeof(double));
+	}
+
+	if ( vf && (vf->n == nf) && !memcmp(vf->basis, system->pbc->basis, sizeof(vf->basis)) && !memcmp(vf->key, key, 4*nf*sizeof(double)) ) {
+		free(key);
+		return vf;
+	}
+
+	free_vdw_frozen(vf);
+	vf = calloc(1,sizeof(vdw_frozen_t));
+	checknull(vf,"vdw_frozen_t * vf",sizeof(vdw_frozen_t));
+	vf->n = nf;
+	vf->key = key;
+	memcpy(vf->basis, system->pbc->basis, sizeof(vf->basis));
+
+	//the frozen block, diagonalized with eigenvectors
+	Fc = alloc_mtx(nf);
+	for ( a=0; a<nf; a++ )
+		for ( b=0; b<=a; b++ )
+			(Fc->val)[a+b*nf] = Am[fidx[a]][fidx[b]]*sqrtKinv[fidx[a]]*sqrtKinv[fidx[b]];
+	eigvals = lapack_diag(system,Fc,2,CDVDW_DSYEV);
+	vf->evals = malloc(nf*sizeof(double));
+	checknull(vf->evals,"double * evals",nf*sizeof(double));
+	if ( nf ) memcpy(vf->evals, eigvals, nf*sizeof(double));
+	vf->evects = Fc->val;
+	free(Fc);
+	vf->e_mb = eigen2energy(vf->evals, nf, system->temperature);
+
+	//less the isolated frozen molecules, which are runs of the same molecule in fidx
+	for ( a=0; a<nf; a=b ) {
+		for ( b=a; (b<nf) && (fmol[b]==fmol[a]); b++ );
+		nm = b-a;
+		Fc = alloc_mtx(nm);
+		for ( i=0; i<nm; i++ )
+			for ( m=0; m<=i; m++ )
+				(Fc->val)[i+m*nm] = Am[fidx[a+i]][fidx[a+m]]*sqrtKinv[fidx[a+i]]*sqrtKinv[fidx[a+m]];
+		eigvals = lapack_diag(system,Fc,1,CDVDW_DSYEV);
+		vf->e_mb -= eigen2energy(eigvals, nm, system->temperature);
+		free_mtx(Fc);
+	}
+
+	system->vdw_frozen = vf;
+	return vf;
+}
+
+//many-body energy (a.u.) by frequency quadrature; returns 0 if it can't be used here, and C is diagonalized instead
+static int vdw_quadrature ( system_t * system, double * sqrtKinv, double * e_mb ) {
+	char transa='T', transb='N', uplo='L';
+	int a, b, c, i, k, p, n, nf, ns, nq, nmol, ok = 1;
+	int * fidx, * fmol, * sidx, * smol, * molflag;
+	double ** Am = system->A_matrix;
+	double * B, * Bt, * Y, * M, * x, * w;
+	double one = 1.0, zero = 0.0, minus_one = -1.0;
+	double w0, u, u2, du, ld, ld_iso, integral;
+	molecule_t * mp;
+	atom_t * ap;
+	vdw_frozen_t * vf = NULL;
+
+	n = 3*system->natoms;
+	nq = system->cdvdw_quadrature;
+
+	fidx = malloc(n*sizeof(int)); checknull(fidx,"int * fidx",n*sizeof(int));
+	fmol = malloc(n*sizeof(int)); checknull(fmol,"int * fmol",n*sizeof(int));
+	sidx = malloc(n*sizeof(int)); checknull(sidx,"int * sidx",n*sizeof(int));
+	smol = malloc(n*sizeof(int)); checknull(smol,"int * smol",n*sizeof(int));
+
+	//index the rows of C on frozen and on mobile sites, with the molecule of each
+	i = nf = ns = nmol = 0;
+	for ( mp = system->molecules; mp; mp=mp->next, nmol++ )
+		for ( ap = mp->atoms; ap; ap = ap->next )
+			for ( p=0; p<3; p++, i++ ) {
+				if ( sqrtKinv[i] == 0 ) continue;
+				if ( ap->frozen ) { fidx[nf] = i; fmol[nf++] = nmol; }
+				else { sidx[ns] = i; smol[ns++] = nmol; }
+			}
+
+	//a molecule with sites on both sides would couple the blocks of D
+	molflag = calloc(nmol+1,sizeof(int)); checknull(molflag,"int * molflag",(nmol+1)*sizeof(int));
+	for ( a=0; a<nf; a++ ) molflag[fmol[a]] = 1;
+	for ( a=0; a<ns; a++ ) if ( molflag[smol[a]] ) ok = 0;
+	free(molflag);
+
+	if ( ok ) {
+		vf = vdw_frozen_setup(system, sqrtKinv, fidx, fmol, nf);
+		for ( a=0; a<nf; a++ ) if ( !(vf->evals[a] > 0) ) ok = 0; //catastrophe in the frozen block
+	}
+	if ( !ok ) {
+		free(fidx); free(fmol); free(sidx); free(smol);
+		return 0;
+	}
+
+	//the coupling to the frozen sites in the eigenbasis of F: Bt = Q^T B
+	B = malloc(nf*ns*sizeof(double)); checknull(B,"double * B",nf*ns*sizeof(double));
+	Bt = malloc(nf*ns*sizeof(double)); checknull(Bt,"double * Bt",nf*ns*sizeof(double));
+	Y = malloc(nf*ns*sizeof(double)); checknull(Y,"double * Y",nf*ns*sizeof(double));
+	M = malloc(ns*ns*sizeof(double)); checknull(M,"double * M",ns*ns*sizeof(double));
+	for ( b=0; b<ns; b++ )
+		for ( a=0; a<nf; a++ )
+			B[a+b*nf] = Am[fidx[a]][sidx[b]]*sqrtKinv[fidx[a]]*sqrtKinv[sidx[b]];
+	if ( nf && ns ) dgemm_(&transa, &transb, &nf, &ns, &nf, &one, vf->evects, &nf, B, &nf, &zero, Bt, &nf);
+
+	//the frequency scale is the rms omega of the sites
+	for ( w0=0, a=0; a<nf; a++ ) w0 += Am[fidx[a]][fidx[a]]*sqrtKinv[fidx[a]]*sqrtKinv[fidx[a]];
+	for ( a=0; a<ns; a++ ) w0 += Am[sidx[a]][sidx[a]]*sqrtKinv[sidx[a]]*sqrtKinv[sidx[a]];
+	w0 = (nf+ns) ? sqrt(w0/(nf+ns)) : 1.0;
+
+	//u = w0 (1+x)/(1-x) maps [-1,1) onto [0,inf)
+	x = malloc(nq*sizeof(double)); checknull(x,"double * x",nq*sizeof(double));
+	w = malloc(nq*sizeof(double)); checknull(w,"double * w",nq*sizeof(double));
+	vdw_gauss_legendre(nq, x, w);
+
+	integral = 0;
+	for ( k=0; (k<nq) && ok; k++ ) {
+		u = w0*(1.0+x[k])/(1.0-x[k]);
+		du = w[k]*2.0*w0/((1.0-x[k])*(1.0-x[k]));
+		u2 = u*u;
+
+		//S + u^2 - Bt^T (L + u^2)^-1 Bt, lower triangle
+		for ( b=0; b<ns; b++ )
+			for ( a=0; a<nf; a++ )
+				Y[a+b*nf] = Bt[a+b*nf]/sqrt(vf->evals[a]+u2);
+		for ( b=0; b<ns; b++ ) {
+			for ( a=b; a<ns; a++ )
+				M[a+b*ns] = Am[sidx[a]][sidx[b]]*sqrtKinv[sidx[a]]*sqrtKinv[sidx[b]];
+			M[b+b*ns] += u2;
+		}
+		if ( nf && ns ) dsyrk_(&uplo, &transa, &ns, &nf, &minus_one, Y, &nf, &one, M, &ns);
+		ld = vdw_logdet(ns, M, ns);
+
+		//less the isolated mobile molecules, the runs of the same molecule in sidx
+		ld_iso = 0;
+		for ( a=0; a<ns; a=c ) {
+			for ( c=a; (c<ns) && (smol[c]==smol[a]); c++ );
+			for ( b=a; b<c; b++ ) {
+				for ( i=b; i<c; i++ )
+					M[i+b*ns] = Am[sidx[i]][sidx[b]]*sqrtKinv[sidx[i]]*sqrtKinv[sidx[b]];
+				M[b+b*ns] += u2;
+			}
+			ld_iso += vdw_logdet(c-a, M+a+a*ns, ns);
+		}
+
+		if ( !isfinite(ld) || !isfinite(ld_iso) ) ok = 0; //catastrophe, not positive definite
+		integral += du*(ld - ld_iso);
+	}
+
+	if ( ok ) *e_mb = vf->e_mb + integral/M_PI;
+
+	free(fidx); free(fmol); free(sidx); free(smol);
+	free(B); free(Bt); free(Y); free(M); free(x); free(w);
+
+	return ok;
+}
+
 //returns interaction VDW energy
 double vdw(system_t *system) {
 
 	int N; //  dimC;  (unused variable)  //number of atoms, number of non-zero rows in C-Matrix
 	double e_total, e_iso; //total energy, isolation energy (atoms @ infinity)
+	double e_mb; //many-body energy, e_total - e_iso
 	double * sqrtKinv; //matrix K^(-1/2); cholesky decomposition of K
 	double ** Am = system->A_matrix; //A_matrix
 	struct mtx * Cm; //C_matrix (we use single pointer due to LAPACK requirements)
 	double * eigvals; //eigenvales
 	double fh_corr, lr_corr;
+	vdw_lapack_t * ws = vdw_lapack_workspace(system); //keeps the time spent in each stage
+	struct timeval t;
 
 	N=system->natoms;
+	gettimeofday(&t, NULL);
 
 	//allocate arrays. sqrtKinv is a diagonal matrix. d,e are used for matrix diag.
 	sqrtKinv = getsqrtKinv(system,N);
 
-	//calculate energy vdw of isolated molecules
-	e_iso = sum_eiso_vdw ( system, sqrtKinv );
-
-	//Build the C_Matrix
-	Cm = build_M (3*N, 0, Am, sqrtKinv);
-
-	//setup and use lapack diagonalization routine dsyev_()
-	eigvals = lapack_diag (Cm, system->polarvdw); //eigenvectors if system->polarvdw == 2
-	if ( system->polarvdw == 2 )
-		printevects(Cm);
-
-	//return energy in inverse time (a.u.) units
-	e_total = eigen2energy(eigvals, Cm->dim, system->temperature);
-	e_total *= au2invsec * halfHBAR; //convert a.u. -> s^-1 -> K
-
-	//vdw energy comparison
-	if ( system->polarvdw == 3 )
-		printf("VDW Two-Body | Many Body = %lf | %lf\n", twobody(system),e_total-e_iso);
+	//the many-body energy without diagonalizing C, if we can
+	if ( system->cdvdw_quadrature && vdw_quadrature(system, sqrtKinv, &e_mb) ) {
+		e_mb *= au2invsec * halfHBAR; //convert a.u. -> s^-1 -> K
+		ws->time_diag += vdw_lap(&t);
+	}
+	else {
+		//calculate energy vdw of isolated molecules
+		e_iso = sum_eiso_vdw ( system, sqrtKinv );
+		ws->time_eiso += vdw_lap(&t);
+
+		//Build the C_Matrix
+		Cm = build_M (3*N, 0, Am, sqrtKinv);
+		ws->time_build += vdw_lap(&t);
+
+		//setup and use lapack diagonalization routine (dsyev_() unless cdvdw_eigensolver says otherwise)
+		eigvals = lapack_diag (system, Cm, system->polarvdw, system->cdvdw_eigensolver); //eigenvectors if system->polarvdw == 2
+		if ( system->polarvdw == 2 )
+			printevects(Cm);
+
+		//return energy in inverse time (a.u.) units
+		e_total = eigen2energy(eigvals, Cm->dim, system->temperature);
+		e_total *= au2invsec * halfHBAR; //convert a.u. -> s^-1 -> K
+		e_mb = e_total - e_iso;
+
+		free_mtx(Cm);
+		ws->time_diag += vdw_lap(&t);
+	}
 
 	if ( system->feynman_hibbs ) {
 		if ( system->vdw_fh_2be ) fh_corr = fh_vdw_corr_2be(system); //2be method
@@ -598,12 +975,16 @@ double vdw(system_t *system) {
 
 	if ( system->rd_lrc ) lr_corr = lr_vdw_corr(system);
 	else lr_corr=0;
+	ws->time_corr += vdw_lap(&t);
+	ws->calls++;
+
+	//vdw energy comparison
+	if ( system->polarvdw == 3 )
+		printf("VDW Two-Body | Many Body = %lf | %lf\n", twobody(system),e_mb);
 
 //cleanup and return
 	free(sqrtKinv);
-	free(eigvals);
-	free_mtx(Cm);
 
-	return e_total - e_iso + fh_corr + lr_corr;
+	return e_mb + fh_corr + lr_corr;
 
 }
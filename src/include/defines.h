@@ -57,6 +57,15 @@
 
 
 #define MAX_ITERATION_COUNT                     128
+#define CHOLESKY_BLOCK                          64
+#define THOLE_MATRIX_ALIGN                      64
+#define THOLE_MATRIX_FREE_TILE                  64
+#define POLAR_FRAME_FIELD_REBUILD               1000
+#define POLAR_PREDICT_SWEEPS                    2
+#define POLAR_REFINE_SWEEPS                     4
+#define VDW_EISO_BUCKETS                        256
+#define VDW_EISO_TOLERANCE                      1.0e-8
+#define DISP_TYPES_START                        16
 
 #define EWALD_ALPHA                             0.5
 #define EWALD_KMAX                              7
@@ -81,6 +90,38 @@
 #define FEYNMAN_KLEINERT_TOLERANCE              1.0e-12                 /* tolerance in A^2 */
 /*tolerance in r and r->img when comparisons are made for system->pbc->cutoff and similar boxsize issues*/
 #define SMALL_dR																1.0e-12 
+/*default verlet skin for the neighbor list (A)*/
+#define NEIGHBOR_SKIN 1.0
+/*pair_t nlist_member states: on the old list but not (yet) the new one, and joined at a build before it was imaged*/
+#define NEIGHBOR_LEAVING -1
+#define NEIGHBOR_ENTERED 2
+/*pair iteration for cutoff-limited kernels; walks the neighbor list when it is enabled*/
+#define PAIR_HEAD(system,atom) ((system)->neighbor_list ? (atom)->nlist : (atom)->pairs)
+#define PAIR_NEXT(system,pair) ((system)->neighbor_list ? (pair)->nlist_next : (pair)->next)
+/*frozen-frozen pairs that have no pair_t allocated, see prune_frozen_pairs*/
+#define PAIR_PRUNED(system,atom_i,atom_j) ((system)->prune_frozen_pairs && (atom_i)->frozen && (atom_j)->frozen)
+/*framework potential grids: default spacing (A), node cap and steep-wall threshold (K)*/
+#define FRAMEWORK_GRID_SPACING 0.2
+#define FRAMEWORK_GRID_EMAX 1.0e5
+#define FRAMEWORK_GRID_ESTEEP 1.0e3
+/*framework grid file header length and format version, and accuracy samples per dimension*/
+#define FRAMEWORK_GRID_HEADER 24
+#define FRAMEWORK_GRID_VERSION 2
+#define FRAMEWORK_GRID_SAMPLES 12
+/*incremental energy: default steps between full recomputes and the relative drift that gets reported*/
+#define INCREMENTAL_ENERGY_CHECK 1000
+#define INCREMENTAL_ENERGY_TOLERANCE 1.0e-8
+/*default steps between full structure factor sums for ewald_incremental*/
+#define EWALD_INCREMENTAL_REFRESH 1000
+/*default interpolation error bound for the tabulated real-space ewald kernel*/
+#define EWALD_TABLE_TOLERANCE 1.0e-12
+/*smooth particle mesh ewald: default B-spline order and target grid spacing (A)*/
+#define SPME_ORDER 6
+#define SPME_SPACING 1.0
+#define SPME_MAX_ORDER 16
+/*framework grid mixing flags*/
+#define FRAMEWORK_GRID_RD_EXCLUDED 0x1
+#define FRAMEWORK_GRID_ATTRACTIVE 0x2
 /*default frequency for parallel tempering bath swaps*/
 #define PTEMP_FREQ_DEFAULT 20
 
@@ -88,6 +129,8 @@
 enum { REAL, IMAGINARY };
 enum { READ, WRITE, APPEND }; //file open modes for filecheck()
 enum { DAMPING_OFF, DAMPING_LINEAR, DAMPING_EXPONENTIAL };
+enum { POLAR_SOLVER_FIXED_POINT, POLAR_SOLVER_CG };
+enum { CDVDW_DSYEV, CDVDW_DSYEVD, CDVDW_DSYEVR };
 enum { NUCLEAR_SPIN_PARA, NUCLEAR_SPIN_ORTHO };
 enum {
 	ENSEMBLE_UVT,
@@ -7,8 +7,22 @@
 /* energy */
 double energy(system_t *);
 double energy_no_observables(system_t *);
+void update_energy_observables(system_t *, double);
+int energy_incremental_move(system_t *);
+double energy_incremental(system_t *);
+double energy_incremental_check(system_t *, double);
 double cavity_absolute_check (system_t *);
 double lj(system_t *);
+double lj_lrc_pairs(system_t *, double);
+double lj_lrc_corr(system_t *, atom_t *, pair_t *, double);
+double lj_lrc_self(system_t *, atom_t *, double);
+double lj_fh_corr(system_t *, molecule_t *, pair_t *, int, double, double);
+void setup_framework_grid(system_t *);
+void free_framework_grid(system_t *);
+double framework_grid_rd(system_t *);
+double framework_grid_es(system_t *);
+double framework_grid_molecule_rd(system_t *, molecule_t *);
+double framework_grid_molecule_es(system_t *, molecule_t *);
 double lj_nopbc(system_t *);
 double exp_repulsion(system_t *);
 double exp_repulsion_nopbc(system_t *);
@@ -20,9 +34,14 @@ double disp_expansion_lrc(const system_t *, pair_t *, const double);
 double disp_expansion_lrc_self(const system_t *, atom_t *, const double);
 double disp_expansion(system_t *);
 double disp_expansion_nopbc(system_t *);
+void disp_expansion_mix_atoms(const system_t *, const atom_t *, const atom_t *, disp_mix_t *);
+const disp_mix_t *disp_expansion_mix(system_t *, atom_t *, atom_t *);
+void free_disp_types(disp_types_t *);
 double axilrod_teller ( system_t *system );
+double axilrod_teller_molecule ( system_t *system, molecule_t *molecule, molecule_t *skip );
 double factorial(int);
 double tt_damping(int,double);
+void tt_damping_6_8_10(double, double *, double *, double *);
 void countN(system_t *);
 void update_com(molecule_t *);
 void flag_all_pairs(system_t *);
@@ -34,6 +53,11 @@ void update_pairs_insert(system_t *);
 void update_pairs_remove(system_t *);
 void unupdate_pairs_insert(system_t *);
 void unupdate_pairs_remove(system_t *);
+int neighbor_list_expired(system_t *);
+int neighbor_list_full_update(system_t *);
+void neighbor_list_build(system_t *);
+void neighbor_list_thread(atom_t *);
+void neighbor_list_index(atom_t *);
 double pbc_cutoff(pbc_t *);
 double pbc_volume(pbc_t *);
 void pbc(system_t *);
@@ -43,6 +67,19 @@ double coulombic(system_t *);
 double coulombic_wolf(system_t *);
 double coulombic_real(system_t *);
 double coulombic_reciprocal(system_t *);
+double coulombic_reciprocal_delta(system_t *, molecule_t *, molecule_t *);
+void ewald_sf_checkpoint(system_t *);
+void ewald_sf_restore(system_t *);
+void free_ewald_sf(system_t *);
+double coulombic_reciprocal_spme(system_t *);
+double coulombic_reciprocal_spme_delta(system_t *);
+void spme_checkpoint(system_t *);
+void spme_restore(system_t *);
+void free_spme(system_t *);
+double coulombic_real_FH(molecule_t *, pair_t *, double, double, system_t *);
+ewald_table_t *ewald_table_setup(system_t *, ewald_table_t *, double, double);
+void ewald_table_eval(ewald_table_t *, double, double, double *, double *);
+void free_ewald_table(ewald_table_t *);
 double coulombic_background(system_t *);
 double coulombic_nopbc(molecule_t *);
 double coulombic_real_gwp(system_t *);
@@ -210,17 +247,32 @@ void thole_field_nopbc(system_t *);
 void thole_field_real(system_t *);
 void thole_field_recip(system_t *);
 void thole_field_self(system_t *);
-double * polar_wolf_alpha_lookup_init (system_t *);
-double polar_wolf_alpha_getval(system_t *, double);
+void free_thole_frame_field(thole_frame_field_t *);
 int thole_iterative(system_t *);
 void invert_matrix(int, double **, double **);
+void thole_solve_dipoles(system_t *);
+void LU_decomp(double **, int, int *, double *);
+void LU_bksb(double **, int, int *, double *);
 int countNatoms(system_t *);
 void thole_resize_matrices(system_t *);
+void free_thole_sparse(thole_sparse_t *);
+void free_thole_incremental(thole_incremental_t *);
+void thole_amatrix_diagonal(atom_t *, double *);
+void thole_matrix_free_pack(system_t *);
+void thole_matrix_free_load(system_t *, double *);
+void thole_matrix_free_update(system_t *, int);
+void thole_matrix_free_field(system_t *, int, double *);
+void thole_matrix_free_matvec(system_t *, int, double *);
+void free_thole_matrix_free(thole_matrix_free_t *);
 void print_matrix(int N, double **matrix);
 void ewald_estatic ( system_t * );
 void ewald_full (system_t *);
+void free_ewald_eikr(ewald_eikr_t *);
 void calc_dipole_rrms (system_t *);
 int are_we_done_yet( system_t *, int );
+int polar_warm_ready(system_t *);
+void polar_warm_checkpoint(system_t *);
+void polar_warm_restore(system_t *);
 
 /* polarization - CUDA */
 #ifdef CUDA
@@ -229,7 +281,9 @@ float polar_cuda(system_t *);
 
 /* linear algebra - VDW */
 double vdw(system_t *);
-void free_vdw_eiso(vdw_t *);
+void free_vdw_eiso(vdw_t **);
+void free_vdw_frozen(vdw_frozen_t *);
+void free_vdw_lapack(vdw_lapack_t *);
 
 /* pimc */
 int pimc(system_t *);
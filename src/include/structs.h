@@ -32,9 +32,12 @@ typedef struct _pair {
 	double rd_energy, es_real_energy, es_self_intra_energy;
 	double sigrep;
 	double c6,c8,c10;
+	int nlist_member; //is this pair threaded on the neighbor list? (NEIGHBOR_ENTERED until pairs() has imaged it)
+	int nlist_index; //atom_array index of the pair partner, used to relink neighbor list pairs
 	struct _atom * atom; 
 	struct _molecule * molecule;
 	struct _pair * next;
+	struct _pair * nlist_next; //next pair on the neighbor list
 } pair_t;
 
 
@@ -48,13 +51,20 @@ typedef struct _atom {
 	double pos[3], wrapped_pos[3]; //absolute and wrapped (into main unit cell) position
 	double ef_static[3], ef_static_self[3], ef_induced[3], ef_induced_change[3];
 	double mu[3], old_mu[3], new_mu[3];
+	double saved_mu[3]; //dipole of the last accepted configuration (polar_warm_start)
+	int thole_index; //1 + row block of this atom in the last A matrix (polar_amatrix_incremental)
+	int frame_field_slot; //1 + slot of this atom in the framework field cache (polar_frame_field)
 	double dipole_rrms;
 	double rank_metric;
 	int gwp_spin;
 	double gwp_alpha;
 	int site_neighbor_id; // dr fluctuations will be applied along the vector from this atom to the atom identified by this variable
 	pair_t *pairs;
+	pair_t *nlist; //pairs within cutoff+skin (subset of pairs)
+	pair_t **pair_index; //pairs in list order, so a neighbor list build can reach them without walking the list
+	double nlist_pos[3]; //position at the last neighbor list build
 	double lrc_self, last_volume; // currently only used in disp_expansion.c
+	int disp_type; //1 + row of this atom's parameters in system->disp_types (disp_expansion)
 	struct _atom *next;
 
 } atom_t;
@@ -87,10 +97,43 @@ typedef struct _molecule {
 //stores vdw energies for each molecule within the coupled dipole model
 typedef struct _vdw {
 	char mtype[MAXLINE];
+	int natoms;
+	double * key;	//alpha and omega of each atom, then its distances to the centroid and to the next atom
 	double energy;
 	struct _vdw * next;
 } vdw_t;
 
+//the frozen (framework) block of the coupled dipole C matrix, diagonalized once for cdvdw_quadrature
+typedef struct _vdw_frozen {
+	int n;			//rows of C on frozen, polarizable sites
+	double * key;		//sqrt(K^-1) and position of each of those rows, to notice a change
+	double basis[3][3];
+	double * evals, * evects;	//its eigenvalues and eigenvectors (column-major)
+	double e_mb;		//many-body energy within the frozen block (a.u.)
+} vdw_frozen_t;
+
+//LAPACK workspace kept between vdw() calls, and the time spent in each stage of vdw()
+typedef struct _vdw_lapack {
+	double * work, * eigvals;	//work array and eigenvalues of the last diagonalization
+	int * iwork;			//integer work array (dsyevd, dsyevr)
+	int lwork, liwork, neigvals;	//their allocated lengths
+	int sized[3][2];		//largest dimension queried, by eigensolver and job (values, vectors)
+	int calls;
+	double time_eiso, time_build, time_diag, time_corr;	//accumulated seconds
+} vdw_lapack_t;
+
+//disp_expansion parameters of an atom type, or coefficients of a pair of types as pair_exclusions() mixes them
+typedef struct _disp_mix {
+	double epsilon, sigma, c6, c8, c10;
+} disp_mix_t;
+
+//the atom types (distinct epsilon, sigma, c6, c8, c10) seen so far, and the mixing of each pair of them
+typedef struct _disp_types {
+	int n, size;			//types in use, allocated
+	disp_mix_t *param;		//epsilon, sigma, c6, c8, c10 of each type
+	disp_mix_t *mix;		//size x size, row i mixed with column j as atom_i with atom_j
+} disp_types_t;
+
 //constants for peng_robinson equation of state
 typedef struct _peng_robinson_constants {
 	double Tc;
@@ -156,6 +199,7 @@ typedef struct _observables {
 	double energy;
 	double coulombic_energy, rd_energy, polarization_energy, vdw_energy, three_body_energy;
 	double dipole_rrms;
+	double dipole_refine;	/* largest correction of the double precision refinement (polar_single_precision) */
 	double kinetic_energy; /* for NVE */
 	double temperature; /* for NVE */
 	double volume; /* for NPT */
@@ -175,6 +219,7 @@ typedef struct _avg_observables {
 	double vdw_energy, vdw_energy_sq, vdw_energy_error;
 	double three_body_energy, three_body_energy_sq, three_body_energy_error;
 	double dipole_rrms, dipole_rrms_sq, dipole_rrms_error;
+	double dipole_refine, dipole_refine_sq, dipole_refine_error;
 	double density, density_sq, density_error;
 	double pore_density, pore_density_error;
 	double percent_wt, percent_wt_error;
@@ -246,6 +291,113 @@ typedef struct _grid {
 	histogram_t *avg_histogram;
 } grid_t;
 
+/* tabulated framework potentials, see framework_grid.c */
+typedef struct _framework_grid {
+	int npts[3];
+	int ntypes, nframe;
+	atom_t *site; //parameters of each tabulated site type
+	double *sigma, *epsilon, *lrc; //per site type
+	double *frame_pos, *frame_charge; //frozen atoms
+	double *mix_sigma, *mix_epsilon; //mixed parameters [type*nframe + frozen atom]
+	int *mix_flags;
+	double *es; //real-space ewald potential per unit charge
+	double **rd; //repulsion/dispersion, one grid per site type
+} framework_grid_t;
+
+/* tabulated real-space ewald kernel, see ewald_table.c */
+typedef struct _ewald_table {
+	int n; //number of nodes
+	double alpha, rmax, h, ih; //node spacing h and its inverse
+	double *node; //erfc, h*d(erfc)/dr, gaussian, h*d(gaussian)/dr per node
+} ewald_table_t;
+
+/* cutoff-truncated Thole A matrix in 3x3 block compressed rows, see thole_matrix.c */
+typedef struct _thole_sparse {
+	int N; //block rows (atoms)
+	int nblocks, max_blocks; //blocks in use and allocated
+	int *row; //row i holds blocks row[i] to row[i+1]-1, the diagonal first
+	int *col; //block column (atom) of each block
+	double *block; //9 per block, row-major
+} thole_sparse_t;
+
+/* what the A matrix was last built from, for patching it in place, see thole_matrix.c */
+typedef struct _thole_incremental {
+	int N, capacity; //atoms in the last build, and atoms the A matrix rows/columns are allocated for
+	atom_t **atoms; //atom at each row block of the last build
+	double *pos, *polarizability; //and its position and polarizability at the time
+	double basis[3][3]; //cell of the last build
+	int *map, *dirty, *used; //scratch: old row block of each atom (-1 if new), blocks to rebuild, old row blocks kept
+	double *scratch; //scratch row
+	double **rows; //scratch row pointers
+} thole_incremental_t;
+
+/* polarizable sites packed for the matrix-free Thole contraction, see thole_matrix_free.c */
+typedef struct _thole_matrix_free {
+	int N, capacity; //sites packed, and allocated for
+	int natoms, max_atoms; //atom array size the site map covers, and is allocated for
+	int *atom; //atom array index of each site
+	int *site; //site of each atom, -1 if it isn't polarizable
+	int *molecule; //molecule of each site, for the es exclusions of DAMPING_OFF
+	double *x, *y, *z; //positions
+	double *polarizability, *charge;
+	double *mux, *muy, *muz; //the dipoles being contracted
+} thole_matrix_free_t;
+
+/* static field between the frozen framework and the sorbates, kept between steps, see thole_field.c */
+typedef struct _thole_frame_field {
+	int nframe; //frozen atoms
+	atom_t **frame_atom; //in atom array order
+	double *frame_pos, *frame_charge; //and their positions and charges
+	molecule_t **frame_molecule;
+	double *frame_ef; //field at each frozen atom from all the sorbate atoms in the slots, 3 per atom
+	double basis[3][3]; //cell the cache was built in
+	int nslots, max_slots; //sorbate atoms whose framework terms are in the cache
+	atom_t **atom; //atom of each slot
+	molecule_t **molecule; //and its molecule (only ever compared against)
+	double *pos, *charge; //its position and charge when its terms were evaluated
+	double *ef; //field at it from the framework, 3 per slot
+	int *used; //scratch: slot still belongs to an atom of the system
+	int calls; //updates since the last full rebuild
+} thole_frame_field_t;
+
+/* stored ewald structure factors, see coulombic.c */
+typedef struct _ewald_sf {
+	int nk; //number of k-vectors in the half-space sum
+	double volume, alpha; //the k-vectors and prefactors below were set up for these
+	double *k; //k-vectors, 3 per entry
+	double *kfactor; //exp(-k^2/4alpha^2)/k^2
+	double *re, *im; //structure factor of the last configuration evaluated
+	double *acc_re, *acc_im; //structure factor of the checkpointed configuration
+	int valid, acc_valid; //re/im and acc_re/acc_im hold a complete sum
+} ewald_sf_t;
+
+/* k-vectors and per-atom phase factors of the polarization ewald sum, see polar_ewald.c */
+typedef struct _ewald_eikr {
+	int nk; //number of k-vectors in the half-space sum
+	double volume, alpha; //the k-vectors and prefactors below were set up for these
+	int *l; //integer indices of the k-vectors, 3 per entry
+	double *k; //k-vectors, 3 per entry
+	double *kfactor; //exp(-k^2/4alpha^2)/k^2
+	int N, max_N; //atoms in the phase tables, and atoms they are allocated for
+	double *cos_kr, *sin_kr; //cos(k.r) and sin(k.r), a row of N atoms per k-vector
+	double *euler_re, *euler_im; //exp(i l theta) along each reciprocal axis, l = 0..kmax, rows of N atoms
+} ewald_eikr_t;
+
+/* smooth particle mesh ewald, see spme.c */
+typedef struct _spme {
+	int order; //B-spline order
+	int npts[3], ntotal;
+	double volume, alpha; //the influence function below was set up for these
+	double *grid; //charge grid, interleaved complex
+	double *influence; //(2pi/V) exp(-k^2/4alpha^2)/k^2 / |b(m)|^2, per grid point
+	double *bsp_mod[3]; //B-spline moduli |b(m)|^-2 along each axis
+	double *roots[3]; //FFT roots of unity along each axis
+	int *factors[3]; //FFT radices along each axis
+	double *line, *line_fft, *butterfly; //FFT scratch
+	double energy, acc_energy; //reciprocal energy of the last evaluated and the checkpointed configuration
+	int valid, acc_valid;
+} spme_t;
+
 /* unused --  kmclaugh 2012 APR 16
 // begin mpi message struct 
 typedef struct _message {
@@ -265,6 +417,9 @@ typedef struct _message {
 typedef struct _checkpoint {
 	int movetype, biased_move;
 	int thole_N_atom; //used for keeping track of thole matrix size (allocated)
+	int neighbor_list_builds; //neighbor list build count when the backup was made
+	int move_pending; //make_move() has perturbed the checkpointed state
+	int dipoles_saved; //saved_mu holds the dipoles of the checkpointed state
 	molecule_t *molecule_backup, *molecule_altered;
 	molecule_t *head, *tail;
 	observables_t *observables;
@@ -426,12 +581,36 @@ typedef struct _system {
 	double rd_anharmonic_k, rd_anharmonic_g;
 	int sg, dreiding, waldmanhagler, lj_buffered_14_7, halgren_mixing, c6_mixing, disp_expansion;
 	int extrapolate_disp_coeffs, damp_dispersion, schmidt_mixing, gilbert_smith_mixing, bohm_ahlrichs_mixing, wilson_popelier_mixing, disp_expansion_mbvdw;
+	disp_types_t *disp_types; //disp_expansion coefficients mixed once per pair of atom types
 	int axilrod_teller, midzuno_kihara_approx;
+	double axilrod_teller_cutoff; //three-body cutoff on each side of the triangle (0 for none)
 	//es_options
 	int wolf;
 	double ewald_alpha, polar_ewald_alpha;
 	int ewald_alpha_set, polar_ewald_alpha_set;
 	int ewald_kmax;
+	int ewald_incremental, ewald_incremental_refresh; //update the stored structure factors by the moved molecule only
+	ewald_sf_t *ewald_sf;
+	int ewald_table; //interpolate erfc/exp in the real-space kernels
+	double ewald_table_tolerance;
+	ewald_table_t *ewald_table_data, *polar_ewald_table;
+	ewald_eikr_t *polar_ewald_eikr; //phase factors shared by the static and induced k-space fields
+	int ewald_spme, ewald_spme_order; //smooth particle mesh ewald in place of the k-sum
+	double ewald_spme_spacing;
+	spme_t *spme;
+	//neighbor list options
+	int neighbor_list, neighbor_list_stale, neighbor_list_natoms, neighbor_list_builds;
+	double neighbor_skin, neighbor_list_volume;
+	double neighbor_rd_lrc; //sum of the pair LRC's, refreshed when the neighbor list is rebuilt
+	int neighbor_rd_lrc_stale;
+	int prune_frozen_pairs; //don't allocate frozen-frozen pairs
+	//framework potential grids
+	int framework_grid;
+	double framework_grid_spacing;
+	char *framework_grid_file;
+	framework_grid_t *framework_grid_data;
+	//single-molecule energy differences for displace/insert/remove moves
+	int incremental_energy, incremental_energy_check;
 	//thole options
 	int polarization, polarvdw, polarizability_tensor;
 	int cdvdw_exp_repulsion, cdvdw_sig_repulsion, cdvdw_9th_repulsion;
@@ -439,11 +618,35 @@ typedef struct _system {
 	int polar_iterative, polar_ewald, polar_ewald_full, polar_zodid, polar_palmo, polar_rrms;
 	int polar_gs, polar_gs_ranked, polar_sor, polar_esor, polar_max_iter, polar_wolf, polar_wolf_full, polar_wolf_alpha_lookup;
 	double polar_wolf_alpha, polar_gamma, polar_damp, field_damp, polar_precision;
+	int polar_solver, polar_sparse, polar_warm_start, polar_amatrix_incremental;
+	int polar_predict;	/* predict the dipoles of the moved molecule before the solve (polar_warm_start) */
+	int *polar_iteration_histogram;	/* dipole solves by iteration count, MAX_ITERATION_COUNT+1 bins, the last for anything longer */
+	int polar_threads;	/* OpenMP threads for the polarization kernels (0 leaves it to OMP_NUM_THREADS) */
+	thole_sparse_t *A_sparse;	/* cutoff-truncated A matrix, when polar_sparse is set */
+	thole_incremental_t *A_incremental;	/* bookkeeping for polar_amatrix_incremental */
+	int polar_matrix_free;
+	thole_matrix_free_t *A_matrix_free;	/* packed sites, when the A matrix is evaluated on the fly */
+	int polar_single_precision;
+	float **A_single, *A_single_block;	/* A matrix in single precision, when polar_single_precision is set */
+	int A_single_ld;
+	int polar_frame_field;
+	thole_frame_field_t *polar_frame_field_data;	/* framework terms of the static field, when polar_frame_field is set */
+	double *polar_field_buffer;	/* per-thread static field buffers, grown on demand */
+	size_t polar_field_buffer_size;
+	int *polar_rank, polar_rank_N;	/* last polar_gs_ranked ordering of the atom array, kept while it holds */
+	double polar_rank_rmin;	/* smallest polarizable separation the rank metrics were counted against */
 	int damp_type;
 	double **A_matrix, **B_matrix, C_matrix[3][3];	/* A matrix, B matrix and polarizability tensor */
-	vdw_t * vdw_eiso_info; //keeps track of molecule vdw self energies
-	double * polar_wolf_alpha_table, polar_wolf_alpha_lookup_cutoff;
-	int polar_wolf_alpha_table_max; //stores the total size of the array
+	double *A_block, *B_block;	/* aligned storage the A and B matrix rows point into */
+	int A_ld, B_ld;	/* their leading dimensions (allocated rows and columns) */
+	vdw_t ** vdw_eiso_info; //molecule vdw self energies, hashed by type into VDW_EISO_BUCKETS chains
+	double vdw_eiso_basis[3][3]; //cell the vdw_eiso_info energies were computed in
+	int cdvdw_quadrature; //frequency quadrature points for the many-body vdw energy (0 diagonalizes C)
+	vdw_frozen_t * vdw_frozen; //diagonalized frozen block for cdvdw_quadrature
+	int cdvdw_eigensolver; //LAPACK routine for the values-only diagonalization of C
+	vdw_lapack_t * vdw_lapack; //its workspace and the vdw stage timings
+	ewald_table_t *polar_wolf_alpha_table;
+	double polar_wolf_alpha_lookup_cutoff;
 
 	// energy-corrections
 	int feynman_hibbs, feynman_kleinert, feynman_hibbs_order;
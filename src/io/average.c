@@ -317,6 +317,13 @@ void update_root_averages(system_t *system, observables_t *observables, avg_obse
 	avg_observables->dipole_rrms_error = sdom*sqrt(avg_observables->dipole_rrms_sq  
 		- avg_observables->dipole_rrms*avg_observables->dipole_rrms);
 
+	avg_observables->dipole_refine = factor*avg_observables->dipole_refine 
+		+ observables->dipole_refine / m;
+	avg_observables->dipole_refine_sq = factor*avg_observables->dipole_refine_sq 
+		+ (observables->dipole_refine*observables->dipole_refine) / m;
+	avg_observables->dipole_refine_error = sdom*sqrt(avg_observables->dipole_refine_sq  
+		- avg_observables->dipole_refine*avg_observables->dipole_refine);
+
 	avg_observables->kinetic_energy = factor*avg_observables->kinetic_energy 
 		+ observables->kinetic_energy / m;
 	avg_observables->kinetic_energy_sq = factor*avg_observables->kinetic_energy_sq 
@@ -2,6 +2,9 @@
 #ifdef MPI
 #include <mpi.h>
 #endif
+#ifdef OPENMP
+#include <omp.h>
+#endif
 
 void check_ensemble ( system_t * system, int ensemble ) {
 
@@ -299,6 +302,138 @@ void polarization_options (system_t * system) {
 		die(-1);
 	}
 
+	if(system->polar_solver == POLAR_SOLVER_CG) {
+		if(!system->polar_iterative || system->polar_ewald_full) {
+			error("INPUT: polar_solver cg requires polar_iterative (and not polar_ewald_full)\n");
+			die(-1);
+		}
+		if(system->cuda || system->opencl) {
+			error("INPUT: polar_solver cg is not available with GPU acceleration\n");
+			die(-1);
+		}
+		if(system->polar_zodid || system->polar_gs || system->polar_gs_ranked || system->polar_sor || system->polar_esor) {
+			error("INPUT: polar_solver cg cannot be combined with polar_zodid, polar_gs, polar_gs_ranked, polar_sor or polar_esor\n");
+			die(-1);
+		}
+		output("INPUT: Thole dipoles will be solved by block-Jacobi preconditioned conjugate gradient\n");
+	}
+
+	if(system->polar_sparse) {
+		if(!system->polar_iterative || system->polar_zodid) {
+			error("INPUT: polar_sparse requires polar_iterative (and is of no use with polar_zodid)\n");
+			die(-1);
+		}
+		if(system->polar_ewald_full || system->polarvdw) {
+			error("INPUT: polar_ewald_full and polarvdw need the dense A matrix, polar_sparse cannot be set\n");
+			die(-1);
+		}
+		if(system->cuda || system->opencl) {
+			error("INPUT: polar_sparse is not available with GPU acceleration\n");
+			die(-1);
+		}
+		output("INPUT: sparse Thole A matrix, dipole interactions truncated at the pair cutoff\n");
+	}
+
+	if(system->polar_warm_start) {
+		if(!system->polar_iterative || system->polar_zodid || system->polar_ewald_full) {
+			error("INPUT: polar_warm_start requires polar_iterative (and is of no use with polar_zodid or polar_ewald_full)\n");
+			die(-1);
+		}
+		if(system->cuda || system->opencl) {
+			error("INPUT: polar_warm_start is not available with GPU acceleration\n");
+			die(-1);
+		}
+		output("INPUT: dipole solves will start from the dipoles of the last accepted configuration\n");
+	}
+
+	if(system->polar_predict) {
+		if(!system->polar_warm_start) {
+			error("INPUT: polar_predict refines the warm start, it requires polar_warm_start\n");
+			die(-1);
+		}
+		output("INPUT: the dipoles of the moved molecule will be predicted from the accepted dipoles of the rest\n");
+	}
+
+	if(system->polar_amatrix_incremental) {
+		if(!system->polar_iterative || system->polar_zodid) {
+			error("INPUT: polar_amatrix_incremental requires polar_iterative (and is of no use with polar_zodid)\n");
+			die(-1);
+		}
+		if(system->polar_sparse) {
+			error("INPUT: polar_amatrix_incremental and polar_sparse cannot both be set\n");
+			die(-1);
+		}
+		if(system->cuda || system->opencl) {
+			error("INPUT: polar_amatrix_incremental is not available with GPU acceleration\n");
+			die(-1);
+		}
+		output("INPUT: the Thole A matrix will be kept between steps and patched for the atoms that moved\n");
+	}
+
+	if(system->polar_matrix_free) {
+		if(!system->polar_iterative || system->polar_zodid) {
+			error("INPUT: polar_matrix_free requires polar_iterative (and is of no use with polar_zodid)\n");
+			die(-1);
+		}
+		if(system->polar_ewald_full || system->polarvdw) {
+			error("INPUT: polar_ewald_full and polarvdw need the dense A matrix, polar_matrix_free cannot be set\n");
+			die(-1);
+		}
+		if(system->polar_sparse || system->polar_amatrix_incremental) {
+			error("INPUT: polar_matrix_free cannot be combined with polar_sparse or polar_amatrix_incremental\n");
+			die(-1);
+		}
+		if(system->cuda || system->opencl) {
+			error("INPUT: polar_matrix_free is not available with GPU acceleration\n");
+			die(-1);
+		}
+		output("INPUT: the Thole A matrix will not be stored, its tensors are evaluated in each contraction\n");
+	}
+
+	if(system->polar_single_precision) {
+		if(!system->polar_iterative || system->polar_zodid || (system->polar_precision == 0.0)) {
+			error("INPUT: polar_single_precision requires polar_iterative with a polar_precision for the refinement to meet\n");
+			die(-1);
+		}
+		if(system->polar_ewald_full || system->polarvdw) {
+			error("INPUT: polar_ewald_full and polarvdw need the dense A matrix, polar_single_precision cannot be set\n");
+			die(-1);
+		}
+		if(system->polar_sparse || system->polar_amatrix_incremental || system->polar_matrix_free) {
+			error("INPUT: polar_single_precision cannot be combined with polar_sparse, polar_amatrix_incremental or polar_matrix_free\n");
+			die(-1);
+		}
+		if(system->cuda || system->opencl) {
+			error("INPUT: polar_single_precision is not available with GPU acceleration\n");
+			die(-1);
+		}
+		output("INPUT: the Thole A matrix will be stored in single precision, the dipoles refined in double\n");
+	}
+
+	if(system->polar_frame_field) {
+		if(system->polar_ewald || system->polar_ewald_full) {
+			error("INPUT: polar_frame_field needs the real-space (wolf or cutoff) static field, it cannot be used with polar_ewald or polar_ewald_full\n");
+			die(-1);
+		}
+		if(system->opencl) {
+			error("INPUT: polar_frame_field is not available with OpenCL, which builds the static field on the device\n");
+			die(-1);
+		}
+		output("INPUT: the framework terms of the static field will be kept between steps and updated for the sorbates that moved\n");
+	}
+
+#ifdef OPENMP
+	if(system->polar_threads < 0) {
+		error("INPUT: polar_threads must be positive (or 0 to leave it to OMP_NUM_THREADS)\n");
+		die(-1);
+	}
+	if(system->polar_threads) omp_set_num_threads(system->polar_threads);
+	sprintf(linebuf, "INPUT: polarization field, A matrix and dipole contractions threaded over %d OpenMP threads\n", omp_get_max_threads());
+	output(linebuf);
+	if(system->polar_iterative && (system->polar_gs || system->polar_gs_ranked))
+		output("INPUT: Gauss-Seidel dipole updates are sequential, only the Jacobi contraction is threaded\n");
+#endif
+
 	if(!system->polar_iterative && system->polar_zodid) {
 		error("INPUT: ZODID and matrix inversion cannot both be set!\n");
 		die(-1);
@@ -426,6 +561,22 @@ void polarization_options (system_t * system) {
 			output("INPUT: C_6*sig^6 repulsion activated\n");
 		if(system->cdvdw_9th_repulsion)
 			output("INPUT: 9th power repulsion mixing activated\n");
+		if(system->cdvdw_quadrature < 0) {
+			error("INPUT: cdvdw_quadrature must be a (non-negative) number of quadrature points\n");
+			die(-1);
+		}
+		if(system->cdvdw_quadrature && (system->polarvdw == 2)) {
+			error("INPUT: polarvdw evects needs the eigenvectors of C, cdvdw_quadrature cannot be set\n");
+			die(-1);
+		}
+		if(system->cdvdw_quadrature) {
+			sprintf(linebuf, "INPUT: many-body vdw energy by %d point frequency quadrature, the frozen block of C is diagonalized once\n", system->cdvdw_quadrature);
+			output(linebuf);
+		}
+		if(system->cdvdw_eigensolver == CDVDW_DSYEVD)
+			output("INPUT: C is diagonalized with dsyevd (eigenvalues only)\n");
+		else if(system->cdvdw_eigensolver == CDVDW_DSYEVR)
+			output("INPUT: C is diagonalized with dsyevr (eigenvalues only)\n");
 		if ( system->cdvdw_exp_repulsion + system->cdvdw_sig_repulsion + system->cdvdw_9th_repulsion + system->waldmanhagler + system->halgren_mixing  > 1 ) {
 			error("INPUT: more than one mixing rules specified");
 			die(1);
@@ -446,6 +597,245 @@ void polarization_options (system_t * system) {
 }
 
 
+void neighbor_list_options (system_t * system) {
+
+	char linebuf[MAXLINE];
+
+	if(system->ensemble == ENSEMBLE_SURF || system->ensemble == ENSEMBLE_SURF_FIT) {
+		error("INPUT: neighbor_list requires periodic boundaries\n");
+		die(-1);
+	}
+
+	if(system->rd_crystal || system->spectre || system->gwp) {
+		error("INPUT: neighbor_list is incompatible with rd_crystal, spectre and gwp\n");
+		die(-1);
+	}
+
+	/* these kernels still walk every pair (disp_expansion has no cutoff) */
+	if(system->dreiding || system->lj_buffered_14_7 || system->disp_expansion || system->cdvdw_exp_repulsion || system->rd_anharmonic) {
+		error("INPUT: neighbor_list is only implemented for the lj and sg repulsion/dispersion potentials\n");
+		die(-1);
+	}
+
+	if(system->neighbor_skin < 0.0) {
+		error("INPUT: neighbor_skin must be non-negative\n");
+		die(-1);
+	}
+
+	sprintf(linebuf, "INPUT: neighbor list activated with a skin of %.3f A\n", system->neighbor_skin);
+	output(linebuf);
+
+	return;
+}
+
+void axilrod_teller_options (system_t * system) {
+
+	char linebuf[MAXLINE];
+
+	if(system->axilrod_teller_cutoff < 0.0) {
+		error("INPUT: axilrod_teller_cutoff must be non-negative\n");
+		die(-1);
+	}
+
+	if(system->axilrod_teller_cutoff > 0.0) {
+		sprintf(linebuf, "INPUT: axilrod-teller triples are cut off at %.3f A on each side\n", system->axilrod_teller_cutoff);
+		output(linebuf);
+	}
+	else
+		output("INPUT: axilrod-teller triples are not cut off\n");
+
+	return;
+}
+
+void framework_grid_options (system_t * system) {
+
+	char linebuf[MAXLINE];
+
+	/* the grids are tabulated once for a fixed, rigid framework */
+	if(system->ensemble != ENSEMBLE_UVT && system->ensemble != ENSEMBLE_NVT && system->ensemble != ENSEMBLE_NVE && system->ensemble != ENSEMBLE_TE) {
+		error("INPUT: framework_grid requires a fixed volume ensemble (uvt, nvt, nve or total_energy)\n");
+		die(-1);
+	}
+
+	if(system->sg || system->dreiding || system->lj_buffered_14_7 || system->disp_expansion || system->rd_anharmonic || system->cdvdw_exp_repulsion) {
+		error("INPUT: framework_grid is only implemented for the lj repulsion/dispersion potential\n");
+		die(-1);
+	}
+
+	if(system->polarization || system->polarvdw) {
+		error("INPUT: framework_grid is incompatible with polarization and polarvdw\n");
+		die(-1);
+	}
+
+	if(system->wolf) {
+		error("INPUT: framework_grid requires ewald electrostatics\n");
+		die(-1);
+	}
+
+	if(system->feynman_hibbs || system->rd_crystal || system->spectre || system->gwp) {
+		error("INPUT: framework_grid is incompatible with feynman_hibbs, rd_crystal, spectre and gwp\n");
+		die(-1);
+	}
+
+	if(system->cavity_autoreject || system->cavity_autoreject_absolute) {
+		error("INPUT: framework_grid is incompatible with cavity_autoreject\n");
+		die(-1);
+	}
+
+	if(system->framework_grid_spacing <= 0.0) {
+		error("INPUT: framework_grid_spacing must be positive\n");
+		die(-1);
+	}
+
+	sprintf(linebuf, "INPUT: framework potential grids activated with a spacing of %.3f A\n", system->framework_grid_spacing);
+	output(linebuf);
+
+	return;
+}
+
+void ewald_table_options (system_t * system) {
+
+	char linebuf[MAXLINE];
+
+	if(system->ewald_table_tolerance <= 0.0) {
+		error("INPUT: ewald_table_tolerance must be positive\n");
+		die(-1);
+	}
+
+	sprintf(linebuf, "INPUT: real-space ewald kernels will be interpolated with a tolerance of %.3e\n", system->ewald_table_tolerance);
+	output(linebuf);
+
+	return;
+}
+
+void ewald_spme_options (system_t * system) {
+
+	char linebuf[MAXLINE];
+
+	if(system->ensemble == ENSEMBLE_SURF || system->ensemble == ENSEMBLE_SURF_FIT) {
+		error("INPUT: ewald_spme requires periodic boundaries\n");
+		die(-1);
+	}
+
+	if(system->wolf || system->spectre || system->gwp) {
+		error("INPUT: ewald_spme requires ewald electrostatics (incompatible with wolf, spectre and gwp)\n");
+		die(-1);
+	}
+
+	/* the mesh has no per-k structure factors to update */
+	if(system->ewald_incremental) {
+		error("INPUT: ewald_spme and ewald_incremental are mutually exclusive\n");
+		die(-1);
+	}
+
+	if(system->incremental_energy && system->quantum_rotation) {
+		error("INPUT: ewald_spme with incremental_energy is incompatible with quantum_rotation\n");
+		die(-1);
+	}
+
+	if(system->ewald_spme_order < 3 || system->ewald_spme_order > SPME_MAX_ORDER) {
+		sprintf(linebuf, "INPUT: ewald_spme_order must be between 3 and %d\n", SPME_MAX_ORDER);
+		error(linebuf);
+		die(-1);
+	}
+
+	if(system->ewald_spme_spacing <= 0.0) {
+		error("INPUT: ewald_spme_spacing must be positive\n");
+		die(-1);
+	}
+
+	sprintf(linebuf, "INPUT: smooth particle mesh ewald activated with order %d B-splines and a %.3f A grid spacing\n", system->ewald_spme_order, system->ewald_spme_spacing);
+	output(linebuf);
+
+	return;
+}
+
+void ewald_incremental_options (system_t * system) {
+
+	char linebuf[MAXLINE];
+
+	if(system->wolf || system->spectre || system->gwp) {
+		error("INPUT: ewald_incremental requires ewald electrostatics (incompatible with wolf, spectre and gwp)\n");
+		die(-1);
+	}
+
+	/* the rotational potential is sampled mid-move and would corrupt the stored sums */
+	if(system->quantum_rotation) {
+		error("INPUT: ewald_incremental is incompatible with quantum_rotation\n");
+		die(-1);
+	}
+
+	if(system->ewald_incremental_refresh <= 0) {
+		error("INPUT: ewald_incremental_refresh must be positive\n");
+		die(-1);
+	}
+
+	sprintf(linebuf, "INPUT: incremental ewald structure factors activated, fully resummed every %d steps\n", system->ewald_incremental_refresh);
+	output(linebuf);
+
+	return;
+}
+
+void incremental_energy_options (system_t * system) {
+
+	char linebuf[MAXLINE];
+
+	if(system->ensemble != ENSEMBLE_UVT && system->ensemble != ENSEMBLE_NVT && system->ensemble != ENSEMBLE_NVE) {
+		error("INPUT: incremental_energy is only implemented for the uvt, nvt and nve ensembles\n");
+		die(-1);
+	}
+
+	/* many-body terms can't be split into single-molecule contributions */
+	if(system->polarization || system->polarvdw) {
+		error("INPUT: incremental_energy is incompatible with polarization and polarvdw\n");
+		die(-1);
+	}
+
+	if(system->sg || system->dreiding || system->lj_buffered_14_7 || system->disp_expansion || system->rd_anharmonic || system->cdvdw_exp_repulsion || system->cdvdw_sig_repulsion) {
+		error("INPUT: incremental_energy is only implemented for the lj repulsion/dispersion potential\n");
+		die(-1);
+	}
+
+	if(system->wolf) {
+		error("INPUT: incremental_energy requires ewald electrostatics\n");
+		die(-1);
+	}
+
+	if(system->rd_crystal || system->spectre || system->gwp) {
+		error("INPUT: incremental_energy is incompatible with rd_crystal, spectre and gwp\n");
+		die(-1);
+	}
+
+	if(system->incremental_energy_check <= 0) {
+		error("INPUT: incremental_energy_check must be positive\n");
+		die(-1);
+	}
+
+	sprintf(linebuf, "INPUT: incremental energy activated, checked against a full recompute every %d steps\n", system->incremental_energy_check);
+	output(linebuf);
+
+	return;
+}
+
+void prune_frozen_pairs_options (system_t * system) {
+
+	/* the A-matrix and the coupled-dipole matrix need the frozen-frozen separations */
+	if(system->polarization || system->polarvdw) {
+		output("INPUT: frozen-frozen pairs are required for polarization, prune_frozen_pairs disabled\n");
+		system->prune_frozen_pairs = 0;
+		return;
+	}
+
+	if(system->ensemble == ENSEMBLE_SURF || system->ensemble == ENSEMBLE_SURF_FIT) {
+		error("INPUT: prune_frozen_pairs is not supported by the surface ensembles\n");
+		die(-1);
+	}
+
+	output("INPUT: frozen-frozen pairs will not be allocated\n");
+
+	return;
+}
+
 void ensemble_te_options(system_t * system) {
 
 	//nothing to do
@@ -1108,6 +1498,14 @@ int check_system(system_t *system) {
 	if(system->simulated_annealing) simulated_annealing_options(system);
 	if(system->calc_hist) hist_options(system);
 	if(system->polarization) polarization_options(system);
+	if(system->neighbor_list) neighbor_list_options(system);
+	if(system->axilrod_teller) axilrod_teller_options(system);
+	if(system->prune_frozen_pairs) prune_frozen_pairs_options(system);
+	if(system->framework_grid) framework_grid_options(system);
+	if(system->ewald_table) ewald_table_options(system);
+	if(system->ewald_spme) ewald_spme_options(system);
+	if(system->ewald_incremental) ewald_incremental_options(system);
+	if(system->incremental_energy) incremental_energy_options(system);
 #ifdef QM_ROTATION
 	if(system->quantum_rotation) qrot_options(system);
 #endif 
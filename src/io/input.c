@@ -365,6 +365,18 @@ int do_command (system_t * system, char ** token ) {
 			system->polarvdw = 0;
 		else return 1;
 	}
+	else if (!strcasecmp(token[0], "cdvdw_quadrature")) {
+		{ if ( safe_atoi(token[1],&(system->cdvdw_quadrature)) ) return 1; }
+	}
+	else if (!strcasecmp(token[0], "cdvdw_eigensolver")) {
+		if (!strcasecmp(token[1], "dsyev"))
+			system->cdvdw_eigensolver = CDVDW_DSYEV;
+		else if (!strcasecmp(token[1], "dsyevd"))
+			system->cdvdw_eigensolver = CDVDW_DSYEVD;
+		else if (!strcasecmp(token[1], "dsyevr"))
+			system->cdvdw_eigensolver = CDVDW_DSYEVR;
+		else return 1;
+	}
 	else if (!strcasecmp(token[0], "cdvdw_9th_repulsion")) {
 		if (!strcasecmp(token[1], "on"))
 			system->cdvdw_9th_repulsion = 1;
@@ -718,6 +730,8 @@ int do_command (system_t * system, char ** token ) {
 			system->axilrod_teller = 0;
 		else return 1;
 	}
+	else if(!strcasecmp(token[0], "axilrod_teller_cutoff"))
+		{ if ( safe_atof(token[1],&(system->axilrod_teller_cutoff)) ) return 1; }
 	
 	else if(!strcasecmp(token[0], "midzuno_kihara_approx")) {
 		if(!strcasecmp(token[1],"on"))
@@ -789,6 +803,79 @@ int do_command (system_t * system, char ** token ) {
 	else if(!strcasecmp(token[0], "pbc_cutoff"))
 		{ if ( safe_atof(token[1],&(system->pbc->cutoff)) ) return 1; }
 
+	// verlet/cell neighbor list
+	else if(!strcasecmp(token[0], "neighbor_list")) {
+		if(!strcasecmp(token[1],"on"))
+			system->neighbor_list = 1;
+		else if (!strcasecmp(token[1],"off")) 
+			system->neighbor_list = 0;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "neighbor_skin"))
+		{ if ( safe_atof(token[1],&(system->neighbor_skin)) ) return 1; }
+	// framework potential grids
+	else if(!strcasecmp(token[0], "framework_grid")) {
+		if(!strcasecmp(token[1],"on"))
+			system->framework_grid = 1;
+		else if (!strcasecmp(token[1],"off")) 
+			system->framework_grid = 0;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "framework_grid_spacing"))
+		{ if ( safe_atof(token[1],&(system->framework_grid_spacing)) ) return 1; }
+	else if(!strcasecmp(token[0], "ewald_table")) {
+		if(!strcasecmp(token[1], "on"))
+			system->ewald_table = 1;
+		else if (!strcasecmp(token[1], "off"))
+			system->ewald_table = 0;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "ewald_table_tolerance"))
+		{ if ( safe_atof(token[1],&(system->ewald_table_tolerance)) ) return 1; }
+	else if(!strcasecmp(token[0], "ewald_spme")) {
+		if(!strcasecmp(token[1], "on"))
+			system->ewald_spme = 1;
+		else if (!strcasecmp(token[1], "off"))
+			system->ewald_spme = 0;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "ewald_spme_order"))
+		{ if ( safe_atoi(token[1],&(system->ewald_spme_order)) ) return 1; }
+	else if(!strcasecmp(token[0], "ewald_spme_spacing"))
+		{ if ( safe_atof(token[1],&(system->ewald_spme_spacing)) ) return 1; }
+	else if(!strcasecmp(token[0], "ewald_incremental")) {
+		if(!strcasecmp(token[1], "on"))
+			system->ewald_incremental = 1;
+		else if (!strcasecmp(token[1], "off"))
+			system->ewald_incremental = 0;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "ewald_incremental_refresh"))
+		{ if ( safe_atoi(token[1],&(system->ewald_incremental_refresh)) ) return 1; }
+	else if(!strcasecmp(token[0], "incremental_energy")) {
+		if(!strcasecmp(token[1], "on"))
+			system->incremental_energy = 1;
+		else if (!strcasecmp(token[1], "off"))
+			system->incremental_energy = 0;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "incremental_energy_check"))
+		{ if ( safe_atoi(token[1],&(system->incremental_energy_check)) ) return 1; }
+	else if (!strcasecmp(token[0], "framework_grid_file")) {
+		if(!system->framework_grid_file) {
+			system->framework_grid_file = calloc(MAXLINE,sizeof(char));
+			memnullcheck(system->framework_grid_file,MAXLINE*sizeof(char),__LINE__-1, __FILE__);
+			strcpy(system->framework_grid_file,token[1]);
+		} else return 1;
+	}
+	else if(!strcasecmp(token[0], "prune_frozen_pairs")) {
+		if(!strcasecmp(token[1],"on"))
+			system->prune_frozen_pairs = 1;
+		else if (!strcasecmp(token[1],"off")) 
+			system->prune_frozen_pairs = 0;
+		else return 1;
+	}
+
 	//polar options
 	else if(!strcasecmp(token[0], "polar_ewald")) {
 		if(!strcasecmp(token[1],"on"))
@@ -823,6 +910,66 @@ int do_command (system_t * system, char ** token ) {
 			system->polar_iterative = 0;
 		else return 1;
 	}
+	else if(!strcasecmp(token[0], "polar_solver")) {
+		if(!strcasecmp(token[1],"fixed_point"))
+			system->polar_solver = POLAR_SOLVER_FIXED_POINT;
+		else if (!strcasecmp(token[1],"cg")) 
+			system->polar_solver = POLAR_SOLVER_CG;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "polar_sparse")) {
+		if(!strcasecmp(token[1],"on"))
+			system->polar_sparse = 1;
+		else if (!strcasecmp(token[1],"off")) 
+			system->polar_sparse = 0;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "polar_warm_start")) {
+		if(!strcasecmp(token[1],"on"))
+			system->polar_warm_start = 1;
+		else if (!strcasecmp(token[1],"off")) 
+			system->polar_warm_start = 0;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "polar_predict")) {
+		if(!strcasecmp(token[1],"on"))
+			system->polar_predict = 1;
+		else if (!strcasecmp(token[1],"off")) 
+			system->polar_predict = 0;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "polar_amatrix_incremental")) {
+		if(!strcasecmp(token[1],"on"))
+			system->polar_amatrix_incremental = 1;
+		else if (!strcasecmp(token[1],"off")) 
+			system->polar_amatrix_incremental = 0;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "polar_frame_field")) {
+		if(!strcasecmp(token[1],"on"))
+			system->polar_frame_field = 1;
+		else if (!strcasecmp(token[1],"off")) 
+			system->polar_frame_field = 0;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "polar_matrix_free")) {
+		if(!strcasecmp(token[1],"on"))
+			system->polar_matrix_free = 1;
+		else if (!strcasecmp(token[1],"off")) 
+			system->polar_matrix_free = 0;
+		else return 1;
+	}
+	else if(!strcasecmp(token[0], "polar_single_precision")) {
+		if(!strcasecmp(token[1],"on"))
+			system->polar_single_precision = 1;
+		else if (!strcasecmp(token[1],"off")) 
+			system->polar_single_precision = 0;
+		else return 1;
+	}
+#ifdef OPENMP
+	else if(!strcasecmp(token[0], "polar_threads"))
+		{ if ( safe_atoi(token[1],&(system->polar_threads)) ) return 1; }
+#endif
 	else if(!strcasecmp(token[0], "polar_palmo")) {
 		if(!strcasecmp(token[1],"on"))
 			system->polar_palmo = 1;
@@ -1182,8 +1329,28 @@ void setdefaults(system_t * system) {
 	system->polar_ewald_alpha = EWALD_ALPHA;
 	system->polar_wolf_alpha_lookup_cutoff = 30.0; //angstroms
 
+	/* default neighbor list skin */
+	system->neighbor_skin = NEIGHBOR_SKIN;
+
+	/* default framework grid spacing */
+	system->framework_grid_spacing = FRAMEWORK_GRID_SPACING;
+
+	/* default error bound for the tabulated real-space ewald kernel */
+	system->ewald_table_tolerance = EWALD_TABLE_TOLERANCE;
+
+	/* default smooth particle mesh ewald parameters */
+	system->ewald_spme_order = SPME_ORDER;
+	system->ewald_spme_spacing = SPME_SPACING;
+
+	/* default interval between full structure factor sums for ewald_incremental */
+	system->ewald_incremental_refresh = EWALD_INCREMENTAL_REFRESH;
+
+	/* default interval between full energy recomputes for incremental_energy */
+	system->incremental_energy_check = INCREMENTAL_ENERGY_CHECK;
+
 	/* default polarization parameters */
 	system->polar_gamma = 1.0;
+	system->polar_solver = POLAR_SOLVER_FIXED_POINT;
 
 	/* default rd LRC flag */
 	system->rd_lrc = 1;
@@ -1346,6 +1513,9 @@ system_t *setup_system(char *input_file) {
 	flag_all_pairs(system);
 	output("INPUT: finished calculating pairwise interactions\n");
 
+	/* tabulate the framework potentials */
+	if(system->framework_grid) setup_framework_grid(system);
+
 	if(!(system->sg || system->rd_only)) {
 		sprintf(linebuf, "INPUT: Ewald gaussian width = %f A\n", system->ewald_alpha);
 		output(linebuf);
@@ -784,6 +784,8 @@ int write_performance(int i, system_t *system) {
 	char linebuf[MAXLINE];
 	double sec_step;
 	static int last_step;
+	int n;
+	vdw_lapack_t *vl;
 
 	gettimeofday(&current_time,NULL);
 	if(i > system->corrtime) {
@@ -804,6 +806,25 @@ int write_performance(int i, system_t *system) {
 		sprintf(linebuf, "OUTPUT: %.3lf sec/step, ETA = %.3lf hrs\n", sec_step, sec_step*(system->numsteps - i)/3600.0);
 		output(linebuf);
 
+		/* how many dipole solves took how many iterations, so far */
+		if(system->polar_iteration_histogram) {
+			output("OUTPUT: dipole solves by iteration count (iterations:solves)");
+			for(n = 0; n <= MAX_ITERATION_COUNT; n++) {
+				if(!system->polar_iteration_histogram[n]) continue;
+				sprintf(linebuf, " %d%s:%d", n, (n == MAX_ITERATION_COUNT) ? "+" : "", system->polar_iteration_histogram[n]);
+				output(linebuf);
+			}
+			output("\n");
+		}
+
+		/* where the coupled dipole vdw time goes, per call so far */
+		if(system->vdw_lapack && system->vdw_lapack->calls) {
+			vl = system->vdw_lapack;
+			sprintf(linebuf, "OUTPUT: vdw ms/call: isolated molecules %.3lf, build C %.3lf, diagonalize %.3lf, corrections %.3lf\n",
+				1.0e3*vl->time_eiso/vl->calls, 1.0e3*vl->time_build/vl->calls, 1.0e3*vl->time_diag/vl->calls, 1.0e3*vl->time_corr/vl->calls);
+			output(linebuf);
+		}
+
 	}	
 
 	last_step = i;
@@ -1003,6 +1024,9 @@ int write_averages(system_t *system) {
 			printf(" (iterations = %.1f +- %.1f)", 
 				averages->polarization_iterations, averages->polarization_iterations_error);
 		}
+		if(system->polar_single_precision)
+			printf(" (single precision, refinement = %e +- %e D)", 
+				averages->dipole_refine, averages->dipole_refine_error);
 
 		printf("\n");
 	}
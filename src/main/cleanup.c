@@ -51,8 +51,10 @@ void free_my_atoms ( molecule_t * molecules ) {
 	}
 
 	//free the atoms
-	while ( i-- )
+	while ( i-- ) {
+		free(aarray[i]->pair_index);
 		free(aarray[i]);
+	}
 
 	//free the temp array
 	free(aarray);
@@ -142,25 +144,14 @@ void free_all_molecules(system_t * system, molecule_t * molecules) {
 /* free the polarization matrices */
 void free_matrices(system_t *system) {
 
-	int i, N;
-	
-	if ( !system->A_matrix && !system->B_matrix )
-		return; //nothing to do
-
-	if ( system->checkpoint->thole_N_atom )
-		N = 3*system->checkpoint->thole_N_atom;
-	else 
-		N = 3*system->natoms;
-
-	for(i = 0; i < N; i++) {
-		free(system->A_matrix[i]);
-		if(!system->polar_iterative)
-			free(system->B_matrix[i]);
-	}
-
+	/* the rows point into one block per matrix */
+	free(system->A_block);
+	free(system->B_block);
 	free(system->A_matrix);
 	free(system->B_matrix);
+	system->A_block = system->B_block = NULL;
 	system->A_matrix = system->B_matrix = NULL;
+	system->A_ld = system->B_ld = 0;
 
 	return;
 }
@@ -200,25 +191,20 @@ void free_rotational(system_t *system) {
 }
 #endif /* QM_ROTATION */
 
-//free vdw pointer which keeps track of e_iso energies
-void free_vdw_eiso(vdw_t * vdw_eiso_info) {
-	vdw_t * vp;
-	vdw_t ** varray = NULL;
-	int i=0;
-
-	for ( vp = vdw_eiso_info; vp; vp=vp->next ) {
-		varray = realloc(varray, sizeof(vdw_t *)*(i+1));
-		memnullcheck(varray,sizeof(vdw_t *)*(i+1), __LINE__-1, __FILE__);
-		varray[i]=vp;
-		i++;
-	}
+//free the table which keeps track of e_iso energies
+void free_vdw_eiso(vdw_t ** vdw_eiso_info) {
+	vdw_t * vp, * vnext;
+	int i;
 
-	while ( i>0 ) {
-		i--;
-		free(varray[i]);
+	for ( i=0; i<VDW_EISO_BUCKETS; i++ ) {
+		for ( vp = vdw_eiso_info[i]; vp; vp=vnext ) {
+			vnext = vp->next;
+			free(vp->key);
+			free(vp);
+		}
 	}
 
-	free(varray);
+	free(vdw_eiso_info);
 
 	return;
 }
@@ -232,10 +218,20 @@ void cleanup(system_t *system) {
 	if(system->quantum_rotation) free_rotational(system);
 #endif /* QM_ROTATION */
 	if(system->polarization && !system->cuda) free_matrices(system);
-
-	if(system->polar_wolf_alpha_lookup)
-		if ( system->polar_wolf_alpha_table )
-			free(system->polar_wolf_alpha_table);
+	free_thole_sparse(system->A_sparse);
+	free_thole_incremental(system->A_incremental);
+	free_thole_matrix_free(system->A_matrix_free);
+	free(system->A_single_block);
+	free(system->A_single);
+	free_thole_frame_field(system->polar_frame_field_data);
+	free(system->polar_field_buffer);
+	free(system->polar_iteration_histogram);
+	free(system->polar_rank);
+
+	free_ewald_table(system->polar_wolf_alpha_table);
+	free_ewald_table(system->polar_ewald_table);
+	free_ewald_eikr(system->polar_ewald_eikr);
+	free_ewald_table(system->ewald_table_data);
 
 	//need to rebuild atom and pair arrays so we can free everything
 	system->natoms = countNatoms(system);
@@ -262,8 +258,15 @@ void cleanup(system_t *system) {
 	if(system->frozen_output) free(system->frozen_output);
 	if(system->surf_preserve_rotation_on) free(system->surf_preserve_rotation_on);
 	if(system->cavity_bias) free_cavity_grid(system);
+	if(system->framework_grid) free_framework_grid(system);
+	if(system->framework_grid_file) free(system->framework_grid_file);
+	if(system->ewald_sf) free_ewald_sf(system);
+	if(system->spme) free_spme(system);
 
 	if ( system->vdw_eiso_info ) free_vdw_eiso(system->vdw_eiso_info);
+	free_vdw_frozen(system->vdw_frozen);
+	free_vdw_lapack(system->vdw_lapack);
+	free_disp_types(system->disp_types);
 
 	// free multi sorbate related stuff
 	if ( system->fugacities )
@@ -15,6 +15,10 @@ void checkpoint(system_t *system) {
 
 	/* save the current observables */
 	memcpy(system->checkpoint->observables, system->observables, sizeof(observables_t));
+	ewald_sf_checkpoint(system);
+	spme_checkpoint(system);
+	polar_warm_checkpoint(system);
+	system->checkpoint->move_pending = 0;
 
 	/* count exchangeable and adiabatic molecules */
 	num_molecules_exchange  = 0;
@@ -184,6 +188,7 @@ void checkpoint(system_t *system) {
 	if(system->checkpoint->molecule_backup) free_molecule(system, system->checkpoint->molecule_backup);
 	/* backup the state that will be altered */
 	system->checkpoint->molecule_backup = copy_molecule(system, system->checkpoint->molecule_altered);
+	system->checkpoint->neighbor_list_builds = system->neighbor_list_builds;
 
 	return;
 }
@@ -307,7 +307,13 @@ int mc(system_t *system) {
 		make_move(system);
 
 		/* calculate the energy change */
-		final_energy = energy(system);
+		if(energy_incremental_move(system)) {
+			final_energy = energy_incremental(system);
+			/* periodically check the running energy against a full recompute */
+			if(!(system->step % system->incremental_energy_check))
+				final_energy = energy_incremental_check(system, final_energy);
+		} else
+			final_energy = energy(system);
 
 #ifdef QM_ROTATION
 		/* solve for the rotational energy levels */
@@ -318,6 +318,7 @@ molecule_t *copy_molecule(system_t *system, molecule_t *src) {
 		atom_dst_ptr->c8 = atom_src_ptr->c8;
 		atom_dst_ptr->c10 = atom_src_ptr->c10;
 		atom_dst_ptr->c9 = atom_src_ptr->c9;
+		atom_dst_ptr->disp_type = atom_src_ptr->disp_type;
 
 		memcpy(atom_dst_ptr->pos, atom_src_ptr->pos, 3*sizeof(double));
 		memcpy(atom_dst_ptr->wrapped_pos, atom_src_ptr->wrapped_pos, 3*sizeof(double));
@@ -326,6 +327,7 @@ molecule_t *copy_molecule(system_t *system, molecule_t *src) {
 		memcpy(atom_dst_ptr->mu, atom_src_ptr->mu, 3*sizeof(double));
 		memcpy(atom_dst_ptr->old_mu, atom_src_ptr->old_mu, 3*sizeof(double));
 		memcpy(atom_dst_ptr->new_mu, atom_src_ptr->new_mu, 3*sizeof(double));
+		memcpy(atom_dst_ptr->saved_mu, atom_src_ptr->saved_mu, 3*sizeof(double));
 
 		atom_dst_ptr->pairs = calloc(1, sizeof(pair_t));
 		memnullcheck(atom_dst_ptr->pairs,sizeof(pair_t),__LINE__-1, __FILE__);
@@ -349,6 +351,8 @@ molecule_t *copy_molecule(system_t *system, molecule_t *src) {
 			pair_dst_ptr->sigma = pair_src_ptr->sigma;
 			pair_dst_ptr->r = pair_src_ptr->r;
 			pair_dst_ptr->rimg = pair_src_ptr->rimg;
+			pair_dst_ptr->nlist_member = pair_src_ptr->nlist_member;
+			pair_dst_ptr->nlist_index = pair_src_ptr->nlist_index;
 
 			pair_dst_ptr->next = calloc(1, sizeof(pair_t));
 			memnullcheck(pair_dst_ptr->next,sizeof(pair_t),__LINE__-1, __FILE__);
@@ -361,6 +365,11 @@ molecule_t *copy_molecule(system_t *system, molecule_t *src) {
 		/* handle an empty list */
 		if(!atom_src_ptr->pairs) atom_dst_ptr->pairs = NULL;
 
+		/* thread the copied pairs onto the neighbor list */
+		memcpy(atom_dst_ptr->nlist_pos, atom_src_ptr->nlist_pos, 3*sizeof(double));
+		neighbor_list_thread(atom_dst_ptr);
+		if(system->neighbor_list) neighbor_list_index(atom_dst_ptr);
+
 		prev_atom_dst_ptr = atom_dst_ptr;
 		atom_dst_ptr->next = calloc(1, sizeof(atom_t));
 		memnullcheck(atom_dst_ptr->next,sizeof(atom_t),__LINE__-1, __FILE__);
@@ -602,6 +611,8 @@ void make_move(system_t *system) {
 		system->checkpoint->biased_move = 0;
 	}
 
+	system->checkpoint->move_pending = 1;
+
 	switch ( system->checkpoint->movetype ) {
 
 		case MOVETYPE_INSERT :  /* insert a molecule at a random pos and orientation */
@@ -768,6 +779,8 @@ void restore(system_t *system) {
 	
 	// restore the remaining observables 
 	memcpy(system->observables, system->checkpoint->observables, sizeof(observables_t));
+	ewald_sf_restore(system);
+	spme_restore(system);
 
 	/* restore state by undoing the steps of make_move() */
 	switch ( system->checkpoint->movetype ) {
@@ -821,11 +834,18 @@ void restore(system_t *system) {
 			system->checkpoint->molecule_altered = NULL; /* Insurance against memory errors */
 			system->checkpoint->molecule_backup = NULL;
 
+			/* the backup's neighbor list flags predate a rebuild */
+			if(system->checkpoint->neighbor_list_builds != system->neighbor_list_builds)
+				system->neighbor_list_stale = 1;
+
 	}	
 	
 	/* renormalize charges */
 	if(system->spectre) spectre_charge_renormalize(system);
 
+	/* the trial dipoles are stale */
+	polar_warm_restore(system);
+
 	/* establish the previous checkpoint again */
 	checkpoint(system);
 
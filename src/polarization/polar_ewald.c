@@ -42,7 +42,11 @@ void real_term ( system_t * system ) {
 	pair_t * pptr;
 	int p;
 	double r, r2, factor, a;
+	double erfc_term, gaussian_term;
+	ewald_table_t * table = NULL;
 	a = system->polar_ewald_alpha; //some ambiguity between ea and ea^2 across the literature
+	if ( system->ewald_table )
+		table = system->polar_ewald_table = ewald_table_setup(system, system->polar_ewald_table, a, system->pbc->cutoff);
 
 	for (mptr = system->molecules; mptr; mptr=mptr->next ) {
 		for (aptr = mptr->atoms; aptr; aptr=aptr->next ) {
@@ -51,9 +55,10 @@ void real_term ( system_t * system ) {
 				r = pptr->rimg;
 				if ( (r > system->pbc->cutoff) || (r == 0.0) ) continue; //if outside cutoff sphere (not sure why r==0 ever) -> skip
 				r2 = r*r; 
+				ewald_table_eval(table, a, r, &erfc_term, &gaussian_term);
 				if (pptr->es_excluded) {
 					//need to subtract self-term (interaction between a site and a neighbor's screening charge (on the same molecule)
-					factor = (2.0*a*OneOverSqrtPi*exp(-a*a*r2)*r - erf(a*r))/(r*r2);
+					factor = (2.0*a*OneOverSqrtPi*gaussian_term*r - (table ? 1.0 - erfc_term : erf(a*r)))/(r*r2);
 					for ( p=0; p<3; p++ ) {
 						aptr->ef_static[p] += factor*pptr->atom->charge * pptr->dimg[p];
 						pptr->atom->ef_static[p] -= factor*aptr->charge * pptr->dimg[p];
@@ -61,7 +66,7 @@ void real_term ( system_t * system ) {
 				} //excluded
 				else { //not excluded
 
-					factor = (2.0*a*OneOverSqrtPi*exp(-a*a*r2)*r + erfc(a*r))/(r2*r);
+					factor = (2.0*a*OneOverSqrtPi*gaussian_term*r + erfc_term)/(r2*r);
 					for ( p=0; p<3; p++ ) { // for each dim, add e-field contribution for the pair
 						aptr->ef_static[p] += factor*pptr->atom->charge * pptr->dimg[p];
 						pptr->atom->ef_static[p] -= factor*aptr->charge * pptr->dimg[p];
@@ -74,60 +79,172 @@ void real_term ( system_t * system ) {
 	return;
 }
 
-//we deviate from drexel's treatment, and instead do a trig identity to get from a pairwise sum to two atomwise rums
-//or ignore drexel, and derive this term from eq (29) in nymand and linse
-void recip_term ( system_t * system ) {
-	molecule_t * mptr;
-	atom_t * aptr;
-	int p, q, l[3], kmax;
-	double ea, k[3], k2, kweight[3], float1, float2;
-	ea = system->polar_ewald_alpha; //actually sqrt(ea)
+/* the k-vectors and their prefactors, these only change with the volume (or alpha) */
+static ewald_eikr_t * polar_ewald_kvectors ( system_t * system ) {
+	ewald_eikr_t * eikr = system->polar_ewald_eikr;
+	int n, p, q, l[3], kmax;
+	double ea, k2;
+	ea = system->polar_ewald_alpha;
 	kmax = system->ewald_kmax;
 
-	//k-space sum (symmetry for k -> -k, so we sum over hemisphere, avoiding double-counting on the face)
-	for (l[0] = 0; l[0] <= kmax; l[0]++) {
-		for (l[1] = (!l[0] ? 0 : -kmax); l[1] <= kmax; l[1]++) {
-			for (l[2] = ((!l[0] && !l[1]) ? 1 : -kmax); l[2] <= kmax; l[2]++) {
+	if ( !eikr ) {
+		eikr = calloc(1, sizeof(ewald_eikr_t));
+		memnullcheck(eikr,sizeof(ewald_eikr_t),__LINE__-1,__FILE__);
+		system->polar_ewald_eikr = eikr;
+
+		//k-space sum (symmetry for k -> -k, so we sum over hemisphere, avoiding double-counting on the face)
+		for (l[0] = 0; l[0] <= kmax; l[0]++)
+			for (l[1] = (!l[0] ? 0 : -kmax); l[1] <= kmax; l[1]++)
+				for (l[2] = ((!l[0] && !l[1]) ? 1 : -kmax); l[2] <= kmax; l[2]++)
+					if ( iidotprod(l,l) <= kmax*kmax ) eikr->nk++;
+
+		eikr->l = calloc(3*eikr->nk, sizeof(int));
+		memnullcheck(eikr->l,3*eikr->nk*sizeof(int),__LINE__-1,__FILE__);
+		eikr->k = calloc(3*eikr->nk, sizeof(double));
+		memnullcheck(eikr->k,3*eikr->nk*sizeof(double),__LINE__-1,__FILE__);
+		eikr->kfactor = calloc(eikr->nk, sizeof(double));
+		memnullcheck(eikr->kfactor,eikr->nk*sizeof(double),__LINE__-1,__FILE__);
+
+		for (l[0] = 0, n = 0; l[0] <= kmax; l[0]++)
+			for (l[1] = (!l[0] ? 0 : -kmax); l[1] <= kmax; l[1]++)
+				for (l[2] = ((!l[0] && !l[1]) ? 1 : -kmax); l[2] <= kmax; l[2]++) {
+					// if |l|^2 > kmax^2, then it doesn't contribute (outside the k-space cutoff)
+					if ( iidotprod(l,l) > kmax*kmax ) continue;
+					for ( p=0; p<3; p++ ) eikr->l[3*n+p] = l[p];
+					n++;
+				}
+	}
 
-				// if |l|^2 > kmax^2, then it doesn't contribute (outside the k-space cutoff)
-				if ( iidotprod(l,l) > kmax*kmax ) continue; 
+	if ( (eikr->volume == system->pbc->volume) && (eikr->alpha == ea) ) return eikr;
 
-				for(p = 0; p < 3; p++) {
-					for(q = 0, k[p] = 0; q < 3; q++)
-						k[p] += 2.0*M_PI*system->pbc->reciprocal_basis[p][q]*l[q];
-				}
-				k2 = dddotprod(k,k);
+	for ( n=0; n<eikr->nk; n++ ) {
+		for(p = 0; p < 3; p++) {
+			for(q = 0, eikr->k[3*n+p] = 0; q < 3; q++)
+				eikr->k[3*n+p] += 2.0*M_PI*system->pbc->reciprocal_basis[p][q]*eikr->l[3*n+q];
+		}
+		k2 = dddotprod(&(eikr->k[3*n]),&(eikr->k[3*n]));
+		eikr->kfactor[n] = exp(-k2/(4.0*ea*ea))/k2;
+	}
 
-				kweight[0] = k[0]/k2 * exp(-k2/(4.0*ea*ea));
-				kweight[1] = k[1]/k2 * exp(-k2/(4.0*ea*ea));
-				kweight[2] = k[2]/k2 * exp(-k2/(4.0*ea*ea));
+	eikr->volume = system->pbc->volume;
+	eikr->alpha = ea;
 
-				float1 = float2 = 0;
-				for (mptr = system->molecules; mptr; mptr=mptr->next )
-					for (aptr = mptr->atoms; aptr; aptr=aptr->next ) {
-						float1 += aptr->charge * cos(dddotprod(k,aptr->pos));
-						float2 += aptr->charge * sin(dddotprod(k,aptr->pos));
-					}
+	return eikr;
+}
 
-				for (mptr = system->molecules; mptr; mptr=mptr->next )
-					for (aptr = mptr->atoms; aptr; aptr=aptr->next ) {
-						for ( p=0; p<3; p++ ) {
-							aptr->ef_static[p] += kweight[p] * sin(dddotprod(k,aptr->pos)) * float1;
-							aptr->ef_static[p] -= kweight[p] * cos(dddotprod(k,aptr->pos)) * float2;
-						}
-					}
+//cos and sin of k.r for every k-vector and atom; the positions are fixed for the whole solve, so this is
+//done once per call (in recip_term) and the induced field iterations only read the table
+//k.r = sum_q l_q theta_q, with theta_q = 2 pi b_q.r, so exp(ik.r) is built up from powers of exp(i theta_q)
+//by the euler recurrence, leaving three cos/sin pairs per atom instead of one per atom and k-vector
+static ewald_eikr_t * polar_ewald_phases ( system_t * system ) {
+	ewald_eikr_t * eikr;
+	atom_t ** aa = system->atom_array;
+	int i, n, p, q, l, N, kmax, stride;
+	double theta, c1, s1, re, im, *re_q, *im_q;
+
+	eikr = polar_ewald_kvectors(system);
+	N = system->natoms;
+	kmax = system->ewald_kmax;
+	stride = (kmax+1)*N;
+
+	if ( N > eikr->max_N ) {
+		eikr->max_N = N;
+		free(eikr->cos_kr);
+		free(eikr->sin_kr);
+		free(eikr->euler_re);
+		free(eikr->euler_im);
+		eikr->cos_kr = calloc(eikr->nk*N, sizeof(double));
+		memnullcheck(eikr->cos_kr,eikr->nk*N*sizeof(double),__LINE__-1,__FILE__);
+		eikr->sin_kr = calloc(eikr->nk*N, sizeof(double));
+		memnullcheck(eikr->sin_kr,eikr->nk*N*sizeof(double),__LINE__-1,__FILE__);
+		eikr->euler_re = calloc(3*stride, sizeof(double));
+		memnullcheck(eikr->euler_re,3*stride*sizeof(double),__LINE__-1,__FILE__);
+		eikr->euler_im = calloc(3*stride, sizeof(double));
+		memnullcheck(eikr->euler_im,3*stride*sizeof(double),__LINE__-1,__FILE__);
+	}
+	eikr->N = N;
+
+	//exp(i l theta_q) for l = 0..kmax
+	for ( q=0; q<3; q++ ) {
+		re_q = eikr->euler_re + q*stride;
+		im_q = eikr->euler_im + q*stride;
+		for ( i=0; i<N; i++ ) {
+			for ( p=0, theta=0; p<3; p++ )
+				theta += 2.0*M_PI*system->pbc->reciprocal_basis[p][q]*aa[i]->pos[p];
+			c1 = cos(theta);
+			s1 = sin(theta);
+			re_q[i] = 1.0;
+			im_q[i] = 0.0;
+			for ( l=1; l<=kmax; l++ ) {
+				re_q[l*N+i] = re_q[(l-1)*N+i]*c1 - im_q[(l-1)*N+i]*s1;
+				im_q[l*N+i] = re_q[(l-1)*N+i]*s1 + im_q[(l-1)*N+i]*c1;
+			}
+		}
+	}
 
-			} //l2
-		} //l1
-	} //l0
+	//exp(ik.r) as the product along the three axes, negative l being the complex conjugate
+	for ( n=0; n<eikr->nk; n++ ) {
+		double *re_x = eikr->euler_re + eikr->l[3*n]*N;
+		double *im_x = eikr->euler_im + eikr->l[3*n]*N;
+		double *re_y = eikr->euler_re + stride + abs(eikr->l[3*n+1])*N;
+		double *im_y = eikr->euler_im + stride + abs(eikr->l[3*n+1])*N;
+		double *re_z = eikr->euler_re + 2*stride + abs(eikr->l[3*n+2])*N;
+		double *im_z = eikr->euler_im + 2*stride + abs(eikr->l[3*n+2])*N;
+		double sy = (eikr->l[3*n+1] < 0) ? -1.0 : 1.0;
+		double sz = (eikr->l[3*n+2] < 0) ? -1.0 : 1.0;
+		double *cos_kr = eikr->cos_kr + n*N;
+		double *sin_kr = eikr->sin_kr + n*N;
 
-	for ( mptr=system->molecules; mptr; mptr=mptr->next ) {
-		for ( aptr=mptr->atoms; aptr; aptr=aptr->next ) {
+		for ( i=0; i<N; i++ ) {
+			re = re_x[i]*re_y[i] - sy*im_x[i]*im_y[i];
+			im = sy*re_x[i]*im_y[i] + im_x[i]*re_y[i];
+			cos_kr[i] = re*re_z[i] - sz*im*im_z[i];
+			sin_kr[i] = sz*re*im_z[i] + im*re_z[i];
+		}
+	}
+
+	return eikr;
+}
+
+//we deviate from drexel's treatment, and instead do a trig identity to get from a pairwise sum to two atomwise rums
+//or ignore drexel, and derive this term from eq (29) in nymand and linse
+void recip_term ( system_t * system ) {
+	atom_t ** aa = system->atom_array;
+	ewald_eikr_t * eikr;
+	int i, n, p, N;
+	double kweight[3], float1, float2, *cos_kr, *sin_kr;
+
+	//new positions, new phase factors
+	eikr = polar_ewald_phases(system);
+	N = eikr->N;
+
+	//k-space sum over the hemisphere
+	for ( n=0; n<eikr->nk; n++ ) {
+		cos_kr = eikr->cos_kr + n*N;
+		sin_kr = eikr->sin_kr + n*N;
+
+		for ( p=0; p<3; p++ )
+			kweight[p] = eikr->k[3*n+p] * eikr->kfactor[n];
+
+		float1 = float2 = 0;
+		for ( i=0; i<N; i++ ) {
+			float1 += aa[i]->charge * cos_kr[i];
+			float2 += aa[i]->charge * sin_kr[i];
+		}
+
+		for ( i=0; i<N; i++ ) {
 			for ( p=0; p<3; p++ ) {
-				//factor of 2 more, since we only summed over hemisphere
-				aptr->ef_static[p] *= 8.0*M_PI/system->pbc->volume;
+				aa[i]->ef_static[p] += kweight[p] * sin_kr[i] * float1;
+				aa[i]->ef_static[p] -= kweight[p] * cos_kr[i] * float2;
 			}
 		}
+	} //k
+
+	for ( i=0; i<N; i++ ) {
+		for ( p=0; p<3; p++ ) {
+			//factor of 2 more, since we only summed over hemisphere
+			aa[i]->ef_static[p] *= 8.0*M_PI/system->pbc->volume;
+		}
 	}
 
 	return;
@@ -187,6 +304,10 @@ void induced_real_term(system_t * system) {
 	int p, q; //dimensions
 	double a = system->polar_ewald_alpha; //ewald damping
 	double l = system->polar_damp; //polar damping
+	ewald_table_t * table = NULL;
+
+	if ( system->ewald_table )
+		table = system->polar_ewald_table = ewald_table_setup(system, system->polar_ewald_table, a, system->pbc->cutoff);
 
 	for ( mptr = system->molecules; mptr; mptr=mptr->next ) {
 		for ( aptr = mptr->atoms; aptr; aptr=aptr->next ) {
@@ -196,8 +317,7 @@ void induced_real_term(system_t * system) {
 				//some things we'll need
 				r=pptr->rimg;
 				ir=1.0/r; ir3=ir*ir*ir; ir5=ir*ir*ir3;
-				erfcar=erfc(a*r);
-				expa2r2=exp(-a*a*r*r);
+				ewald_table_eval(table, a, r, &erfcar, &expa2r2);
 
 				//E_static_realspace_i = sum(i!=j) d_xi d_xj erfc(a*r)/r u_j 
 				s2 = erfcar + 2.0*a*r*OneOverSqrtPi * expa2r2 + 4.0*a*a*a*r*r*r/3.0*OneOverSqrtPi*expa2r2 - damp_factor(l*r,3) ;
@@ -231,68 +351,36 @@ void induced_real_term(system_t * system) {
 	return;
 }
 
+//the phase factors were tabulated by recip_term() for this configuration
 void induced_recip_term(system_t * system) {
-	molecule_t * mptr;
-	atom_t * aptr;
-	atom_t ** aarray = NULL;
-	int i, j, N, l[3];
-	int p, q;
-	double Psin, Pcos, kweight;
-	double a = system->polar_ewald_alpha;
-	double kmax = system->ewald_kmax;
-	double dotprod1, dotprod2, k[3], k2;
-
-	//make atom array
-	N=0;
-	for ( mptr=system->molecules; mptr; mptr=mptr->next ) {
-		for ( aptr=mptr->atoms; aptr; aptr=aptr->next ) {
-			aarray = realloc(aarray, sizeof(atom_t *) * (N+1));
-			memnullcheck(aarray,sizeof(atom_t *)*(N+1),__LINE__-1,__FILE__);
-			aarray[N] = aptr;
-			N++;
-		}
-	}
-
-	//k-space sum (symmetry for k -> -k, so we sum over hemisphere, avoiding double-counting on the face)
-	for (l[0] = 0; l[0] <= kmax; l[0]++) 
-	for (l[1] = (!l[0] ? 0 : -kmax); l[1] <= kmax; l[1]++) 
-	for (l[2] = ((!l[0] && !l[1]) ? 1 : -kmax); l[2] <= kmax; l[2]++) {
+	atom_t ** aa = system->atom_array;
+	ewald_eikr_t * eikr = system->polar_ewald_eikr;
+	int i, n, p, N = eikr->N;
+	double Psin, Pcos, kweight[3], dotprod, *k, *cos_kr, *sin_kr;
 
-		// if |l|^2 > kmax^2, then it doesn't contribute (outside the k-space cutoff)
-		if ( iidotprod(l,l) > kmax*kmax ) continue; 
-
-		for(p = 0; p < 3; p++) {
-			for(q = 0, k[p] = 0; q < 3; q++)
-				k[p] += 2.0*M_PI*system->pbc->reciprocal_basis[p][q]*l[q];
-		}
-		k2 = dddotprod(k,k);
+	//k-space sum over the hemisphere
+	for ( n=0; n<eikr->nk; n++ ) {
+		k = eikr->k + 3*n;
+		cos_kr = eikr->cos_kr + n*N;
+		sin_kr = eikr->sin_kr + n*N;
 
 		for ( p=0; p<3; p++ ) 	
-			kweight = 8.0*M_PI/system->pbc->volume * exp(-k2/(4.0*a*a))/k2 * k[p];
+			kweight[p] = 8.0*M_PI/system->pbc->volume * eikr->kfactor[n] * k[p];
 
 		//calculate Pcos, Psin for this k-point
 		Pcos = Psin = 0;
-		for ( j=0; j<N; j++ ) {
-			dotprod1 = dddotprod(k,aarray[j]->mu);
-			dotprod2 = dddotprod(k,aarray[j]->pos);	
-			Pcos += dotprod1 * cos(dotprod2);
-			Psin += dotprod1 * sin(dotprod2);
+		for ( i=0; i<N; i++ ) {
+			dotprod = dddotprod(k,aa[i]->mu);
+			Pcos += dotprod * cos_kr[i];
+			Psin += dotprod * sin_kr[i];
 		}
 
 		//calculate ef_induced over atom array
-		for ( i=0; i<N; i++ ) {
-			//for each cartesian dimension
-			for ( p=0; p<3; p++ ) {
-				
-				dotprod1 = dddotprod(k,aarray[i]->pos);
-				aarray[i]->ef_induced[p] += kweight * ( -sin(dotprod1)*Psin - cos(dotprod1)*Pcos );
-	
-			} //dim
-		} //ef_incuded over atom array
+		for ( i=0; i<N; i++ )
+			for ( p=0; p<3; p++ )
+				aa[i]->ef_induced[p] += kweight[p] * ( -sin_kr[i]*Psin - cos_kr[i]*Pcos );
 
 	} //kspace	
-		
-	free(aarray);
 
 	return;
 }
@@ -427,3 +515,19 @@ void ewald_full ( system_t * system ) {
 	return;
 }
 
+
+void free_ewald_eikr ( ewald_eikr_t * eikr ) {
+
+	if ( !eikr ) return;
+
+	free(eikr->l);
+	free(eikr->k);
+	free(eikr->kfactor);
+	free(eikr->cos_kr);
+	free(eikr->sin_kr);
+	free(eikr->euler_re);
+	free(eikr->euler_im);
+	free(eikr);
+
+	return;
+}
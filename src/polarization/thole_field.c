@@ -7,8 +7,297 @@ University of South Florida
 */
 
 #include <mc.h>
+#ifdef OPENMP
+#include <omp.h>
+#endif
 #define OneOverSqrtPi 0.56418958354
 
+/* the static field is accumulated pairwise into both atoms, so with OpenMP the rows are dealt */
+/* out in one chunk per thread, each adding into a field buffer of its own; the buffers are kept */
+/* in system_t and summed in chunk order afterwards, so a given thread count always gives the same field */
+static int thole_field_chunks(system_t *system, double **buffer) {
+
+	int nchunks = 1;
+#ifdef OPENMP
+	size_t n;
+#endif
+
+	*buffer = NULL;
+#ifdef OPENMP
+	nchunks = (system->natoms < omp_get_max_threads()) ? system->natoms : omp_get_max_threads();
+	if(nchunks < 2) return 1;
+
+	n = 3*(size_t)nchunks*system->natoms;
+	if(n > system->polar_field_buffer_size) {
+		system->polar_field_buffer = realloc(system->polar_field_buffer, n*sizeof(double));
+		memnullcheck(system->polar_field_buffer, n*sizeof(double), __LINE__-1, __FILE__);
+		system->polar_field_buffer_size = n;
+	}
+	memset(system->polar_field_buffer, 0, n*sizeof(double));
+	*buffer = system->polar_field_buffer;
+#endif
+
+	return nchunks;
+}
+
+/* first row of chunk c; row i has N-i-1 pairs, so the bounds split the triangle into equal areas */
+static int thole_field_row(int c, int nchunks, int N) {
+
+	return N - (int)rint(N*sqrt(1.0 - (double)c/nchunks));
+}
+
+/* add the chunk buffers into ef_static */
+static void thole_field_reduce(system_t *system, int nchunks, double *buffer) {
+
+	int i, c, p, N = system->natoms;
+	atom_t **aa = system->atom_array;
+
+	if(!buffer) return;
+
+#ifdef OPENMP
+	#pragma omp parallel for private(c, p) schedule(static)
+#endif
+	for(i = 0; i < N; i++)
+		for(c = 0; c < nchunks; c++)
+			for(p = 0; p < 3; p++)
+				aa[i]->ef_static[p] += buffer[3*(c*N + i) + p];
+
+	return;
+}
+
+/* field per unit charge at pos from a charge at frame_pos, as the pair loops below evaluate it */
+/* returns 0 if the two are out of range of each other */
+static int thole_frame_field_kernel(system_t *system, ewald_table_t *table, double cutoffterm, double *pos, double *frame_pos, double *k) {
+
+	int p, q;
+	double d[3], img[3], di[3], r, r2, rr, bigmess = 0, erfc_term, gaussian_term;
+	double R = system->pbc->cutoff, rR = 1./R, a = system->polar_wolf_alpha;
+
+	/* minimum image, as in minimum_image() */
+	for(p = 0; p < 3; p++)
+		d[p] = pos[p] - frame_pos[p];
+	for(p = 0; p < 3; p++) {
+		for(q = 0, img[p] = 0; q < 3; q++)
+			img[p] += system->pbc->reciprocal_basis[q][p]*d[q];
+		img[p] = rint(img[p]);
+	}
+	for(p = 0; p < 3; p++)
+		for(q = 0, di[p] = 0; q < 3; q++)
+			di[p] += system->pbc->basis[q][p]*img[q];
+	for(p = 0, r2 = 0; p < 3; p++) {
+		di[p] = d[p] - di[p];
+		r2 += di[p]*di[p];
+	}
+	r = sqrt(r2);
+
+	if(!((r - SMALL_dR < R) && (r != 0.))) return 0;
+
+	if(!(system->polar_wolf || system->polar_wolf_full)) {
+		for(p = 0; p < 3; p++)
+			k[p] = di[p]/(r*r*r);
+		return 1;
+	}
+
+	rr = 1./r;
+	if((a != 0) && !(system->polar_wolf_alpha_lookup && (r >= system->polar_wolf_alpha_lookup_cutoff))) {
+		ewald_table_eval(table, a, r, &erfc_term, &gaussian_term);
+		bigmess = (erfc_term*rr*rr+2.0*a*OneOverSqrtPi*gaussian_term*rr);
+	}
+	for(p = 0; p < 3; p++)
+		k[p] = ((a == 0) ? (rr*rr-rR*rR) : (bigmess-cutoffterm))*di[p]*rr;
+
+	return 1;
+}
+
+/* add (sign = 1) or take back (sign = -1) the terms between the framework and a sorbate atom; */
+/* the framework field at the atom goes to ef, if it isn't NULL */
+static void thole_frame_field_terms(system_t *system, thole_frame_field_t *ff, ewald_table_t *table, double cutoffterm, molecule_t *molecule, double *pos, double charge, double sign, double *ef) {
+
+	int f, p;
+	double k[3];
+
+	if(ef) ef[0] = ef[1] = ef[2] = 0;
+
+	for(f = 0; f < ff->nframe; f++) {
+		if(ff->frame_molecule[f] == molecule) continue; //don't let molecules polarize themselves
+		if(!thole_frame_field_kernel(system, table, cutoffterm, pos, &(ff->frame_pos[3*f]), k)) continue;
+		for(p = 0; p < 3; p++) {
+			if(ef) ef[p] += ff->frame_charge[f]*k[p];
+			ff->frame_ef[3*f+p] -= sign*charge*k[p];
+		}
+	}
+
+	return;
+}
+
+/* give the sorbate atom a slot in the cache */
+static int thole_frame_field_new_slot(thole_frame_field_t *ff, atom_t *atom_ptr) {
+
+	int k = ff->nslots++;
+
+	if(ff->nslots > ff->max_slots) {
+		ff->max_slots = ff->nslots + ff->nslots/8 + 8;
+		ff->atom = realloc(ff->atom, ff->max_slots*sizeof(atom_t *));
+		memnullcheck(ff->atom, ff->max_slots*sizeof(atom_t *), __LINE__-1, __FILE__);
+		ff->molecule = realloc(ff->molecule, ff->max_slots*sizeof(molecule_t *));
+		memnullcheck(ff->molecule, ff->max_slots*sizeof(molecule_t *), __LINE__-1, __FILE__);
+		ff->pos = realloc(ff->pos, 3*ff->max_slots*sizeof(double));
+		memnullcheck(ff->pos, 3*ff->max_slots*sizeof(double), __LINE__-1, __FILE__);
+		ff->charge = realloc(ff->charge, ff->max_slots*sizeof(double));
+		memnullcheck(ff->charge, ff->max_slots*sizeof(double), __LINE__-1, __FILE__);
+		ff->ef = realloc(ff->ef, 3*ff->max_slots*sizeof(double));
+		memnullcheck(ff->ef, 3*ff->max_slots*sizeof(double), __LINE__-1, __FILE__);
+		ff->used = realloc(ff->used, ff->max_slots*sizeof(int));
+		memnullcheck(ff->used, ff->max_slots*sizeof(int), __LINE__-1, __FILE__);
+	}
+
+	ff->atom[k] = atom_ptr;
+	ff->used[k] = 1;
+	atom_ptr->frame_field_slot = k + 1;
+
+	return k;
+}
+
+/* collect the frozen atoms; returns 1 if they aren't the ones the cache was built for */
+static int thole_frame_field_frame(system_t *system, thole_frame_field_t *ff) {
+
+	int i, f, nframe, changed;
+	atom_t **aa = system->atom_array;
+
+	for(i = 0, nframe = 0; i < system->natoms; i++)
+		if(aa[i]->frozen) nframe++;
+
+	changed = (nframe != ff->nframe) || memcmp(ff->basis, system->pbc->basis, sizeof(ff->basis));
+	for(i = 0, f = 0; !changed && (i < system->natoms); i++) {
+		if(!aa[i]->frozen) continue;
+		changed = (ff->frame_atom[f] != aa[i]) || (ff->frame_charge[f] != aa[i]->charge) ||
+			(ff->frame_molecule[f] != system->molecule_array[i]) || memcmp(&(ff->frame_pos[3*f]), aa[i]->pos, 3*sizeof(double));
+		f++;
+	}
+	if(!changed) return 0;
+
+	free(ff->frame_atom);
+	free(ff->frame_pos);
+	free(ff->frame_charge);
+	free(ff->frame_molecule);
+	free(ff->frame_ef);
+	ff->nframe = nframe;
+	ff->frame_atom = calloc(nframe + 1, sizeof(atom_t *));
+	memnullcheck(ff->frame_atom, (nframe + 1)*sizeof(atom_t *), __LINE__-1, __FILE__);
+	ff->frame_pos = calloc(3*nframe + 1, sizeof(double));
+	memnullcheck(ff->frame_pos, (3*nframe + 1)*sizeof(double), __LINE__-1, __FILE__);
+	ff->frame_charge = calloc(nframe + 1, sizeof(double));
+	memnullcheck(ff->frame_charge, (nframe + 1)*sizeof(double), __LINE__-1, __FILE__);
+	ff->frame_molecule = calloc(nframe + 1, sizeof(molecule_t *));
+	memnullcheck(ff->frame_molecule, (nframe + 1)*sizeof(molecule_t *), __LINE__-1, __FILE__);
+	ff->frame_ef = calloc(3*nframe + 1, sizeof(double));
+	memnullcheck(ff->frame_ef, (3*nframe + 1)*sizeof(double), __LINE__-1, __FILE__);
+
+	for(i = 0, f = 0; i < system->natoms; i++) {
+		if(!aa[i]->frozen) continue;
+		ff->frame_atom[f] = aa[i];
+		memcpy(&(ff->frame_pos[3*f]), aa[i]->pos, 3*sizeof(double));
+		ff->frame_charge[f] = aa[i]->charge;
+		ff->frame_molecule[f] = system->molecule_array[i];
+		f++;
+	}
+	memcpy(ff->basis, system->pbc->basis, sizeof(ff->basis));
+
+	return 1;
+}
+
+/* the framework only ever sees the sorbates move, so the framework-sorbate terms of the static field */
+/* are kept from the last call: the atoms that moved (or changed charge) since then have their old terms */
+/* taken back and their new ones added, inserted atoms are added and removed ones taken back; atoms are */
+/* matched to their slots through atom->frame_field_slot, and the cache is rebuilt every so often so */
+/* that rounding doesn't build up. the field is then added to ef_static. */
+static void thole_frame_field(system_t *system, ewald_table_t *table, double cutoffterm) {
+
+	int i, j, k, p, full;
+	atom_t **aa = system->atom_array;
+	thole_frame_field_t *ff;
+
+	if(!system->polar_frame_field_data) {
+		system->polar_frame_field_data = calloc(1, sizeof(thole_frame_field_t));
+		memnullcheck(system->polar_frame_field_data, sizeof(thole_frame_field_t), __LINE__-1, __FILE__);
+	}
+	ff = system->polar_frame_field_data;
+
+	full = thole_frame_field_frame(system, ff) || (++ff->calls >= POLAR_FRAME_FIELD_REBUILD);
+	if(full) {
+		memset(ff->frame_ef, 0, 3*ff->nframe*sizeof(double));
+		ff->nslots = 0;
+		ff->calls = 0;
+	}
+
+	for(k = 0; k < ff->nslots; k++) ff->used[k] = 0;
+
+	for(i = 0; i < system->natoms; i++) {
+		if(aa[i]->frozen) continue;
+
+		k = aa[i]->frame_field_slot - 1;
+		if((k >= 0) && (k < ff->nslots) && (ff->atom[k] == aa[i]) && !ff->used[k]) {
+			ff->used[k] = 1;
+			if((ff->charge[k] == aa[i]->charge) && (ff->molecule[k] == system->molecule_array[i]) && !memcmp(&(ff->pos[3*k]), aa[i]->pos, 3*sizeof(double)))
+				continue;
+			thole_frame_field_terms(system, ff, table, cutoffterm, ff->molecule[k], &(ff->pos[3*k]), ff->charge[k], -1.0, NULL);
+		} else
+			k = thole_frame_field_new_slot(ff, aa[i]);
+
+		ff->molecule[k] = system->molecule_array[i];
+		memcpy(&(ff->pos[3*k]), aa[i]->pos, 3*sizeof(double));
+		ff->charge[k] = aa[i]->charge;
+		thole_frame_field_terms(system, ff, table, cutoffterm, ff->molecule[k], &(ff->pos[3*k]), ff->charge[k], 1.0, &(ff->ef[3*k]));
+	}
+
+	/* take back the atoms that are gone, and close up the slots */
+	for(k = 0, j = 0; k < ff->nslots; k++) {
+		if(!ff->used[k]) {
+			thole_frame_field_terms(system, ff, table, cutoffterm, ff->molecule[k], &(ff->pos[3*k]), ff->charge[k], -1.0, NULL);
+			continue;
+		}
+		if(j != k) {
+			ff->atom[j] = ff->atom[k];
+			ff->molecule[j] = ff->molecule[k];
+			memcpy(&(ff->pos[3*j]), &(ff->pos[3*k]), 3*sizeof(double));
+			ff->charge[j] = ff->charge[k];
+			memcpy(&(ff->ef[3*j]), &(ff->ef[3*k]), 3*sizeof(double));
+		}
+		ff->atom[j]->frame_field_slot = j + 1;
+		j++;
+	}
+	ff->nslots = j;
+
+	for(k = 0; k < ff->nslots; k++)
+		for(p = 0; p < 3; p++)
+			ff->atom[k]->ef_static[p] += ff->ef[3*k+p];
+	for(k = 0; k < ff->nframe; k++)
+		for(p = 0; p < 3; p++)
+			ff->frame_atom[k]->ef_static[p] += ff->frame_ef[3*k+p];
+
+	return;
+}
+
+void free_thole_frame_field(thole_frame_field_t *ff) {
+
+	if(!ff) return;
+
+	free(ff->frame_atom);
+	free(ff->frame_pos);
+	free(ff->frame_charge);
+	free(ff->frame_molecule);
+	free(ff->frame_ef);
+	free(ff->atom);
+	free(ff->molecule);
+	free(ff->pos);
+	free(ff->charge);
+	free(ff->ef);
+	free(ff->used);
+	free(ff);
+
+	return;
+}
+
 //called from energy/polar.c
 /* calculate the field with periodic boundaries */
 void thole_field(system_t *system) {
@@ -42,34 +331,47 @@ void thole_field(system_t *system) {
 /* calculate the field without ewald summation/wolf */
 void thole_field_nopbc(system_t *system) {
 
-	molecule_t *molecule_ptr;
-	atom_t *atom_ptr;
+	atom_t **aa = system->atom_array;
 	pair_t *pair_ptr;
-	int p;
-	double r;
+	int i, j, c, p, N = system->natoms, nchunks;
+	double r, *buffer, *ef_i, *ef_j;
 
-	for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next) {
-		for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
-			for(pair_ptr = atom_ptr->pairs; pair_ptr; pair_ptr = pair_ptr->next) {
+	nchunks = thole_field_chunks(system, &buffer);
 
+#ifdef OPENMP
+	#pragma omp parallel for private(i, j, p, r, pair_ptr, ef_i, ef_j) schedule(static, 1)
+#endif
+	for(c = 0; c < nchunks; c++) {
+		for(i = thole_field_row(c, nchunks, N); i < thole_field_row(c + 1, nchunks, N); i++) {
+			if(system->polar_frame_field && aa[i]->frozen) continue; //the framework terms are cached
+			for(j = (i + 1), pair_ptr = PAIR_HEAD(system, aa[i]); pair_ptr; j++, pair_ptr = PAIR_NEXT(system, pair_ptr)) {
+
+				if(system->neighbor_list) j = pair_ptr->nlist_index;
 				if(pair_ptr->frozen) continue;
-				if (molecule_ptr == pair_ptr->molecule) continue; //don't let molecules polarize themselves
+				if(system->polar_frame_field && pair_ptr->atom->frozen) continue;
+				if (system->molecule_array[i] == pair_ptr->molecule) continue; //don't let molecules polarize themselves
 				
 				r = pair_ptr->rimg;
 
 				//inclusive near the cutoff
 				if((r - SMALL_dR < system->pbc->cutoff) && (r != 0.)) {
 
+					ef_i = buffer ? &(buffer[3*(c*N + i)]) : aa[i]->ef_static;
+					ef_j = buffer ? &(buffer[3*(c*N + j)]) : aa[j]->ef_static;
 					for(p = 0; p < 3; p++) {
-						atom_ptr->ef_static[p] += pair_ptr->atom->charge*pair_ptr->dimg[p]/(r*r*r);
-						pair_ptr->atom->ef_static[p] -= atom_ptr->charge*pair_ptr->dimg[p]/(r*r*r);
+						ef_i[p] += pair_ptr->atom->charge*pair_ptr->dimg[p]/(r*r*r);
+						ef_j[p] -= aa[i]->charge*pair_ptr->dimg[p]/(r*r*r);
 					}
 
 				} /* cutoff */
 
 			} /* pair */
 		} /* atom */
-	} /* molecule */
+	} /* chunk */
+
+	thole_field_reduce(system, nchunks, buffer);
+
+	if(system->polar_frame_field) thole_frame_field(system, NULL, 0);
 
 	return;
 }
@@ -77,9 +379,9 @@ void thole_field_nopbc(system_t *system) {
 // calc field using wolf sum (JCP 124 234104 (2006) equation 19
 void thole_field_wolf(system_t *system) {
 
-	molecule_t *molecule_ptr;
-	atom_t *atom_ptr;
+	atom_t **aa = system->atom_array;
 	pair_t *pair_ptr;
+	int i, j, c, N = system->natoms, nchunks;
 	int p; //dimensionality
 	double r, rr; //r and 1/r (reciprocal of r)
 	double R = system->pbc->cutoff;
@@ -90,17 +392,30 @@ void thole_field_wolf(system_t *system) {
 		erR=erfc(a*R);
 	double cutoffterm = (erR*rR*rR + 2.0*a*OneOverSqrtPi*exp(-a*a*R*R)*rR);
 	double bigmess=0;
+	double erfc_term, gaussian_term;
+	double *buffer, *ef_i, *ef_j;
+	ewald_table_t * table = NULL;
 
-	//init lookup table if needed
-	if ( system->polar_wolf_alpha_lookup && !(system->polar_wolf_alpha_table) )
-		system->polar_wolf_alpha_table = polar_wolf_alpha_lookup_init(system);
+	//init lookup table if needed (beyond the lookup cutoff the field is taken to be zero)
+	if ( (a != 0) && system->polar_wolf_alpha_lookup )
+		table = system->polar_wolf_alpha_table = ewald_table_setup(system, system->polar_wolf_alpha_table, a, system->polar_wolf_alpha_lookup_cutoff);
+	else if ( (a != 0) && system->ewald_table )
+		table = system->polar_wolf_alpha_table = ewald_table_setup(system, system->polar_wolf_alpha_table, a, R);
 
-	for(molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next) {
-		for(atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next) {
-			for(pair_ptr = atom_ptr->pairs; pair_ptr; pair_ptr = pair_ptr->next) {
+	nchunks = thole_field_chunks(system, &buffer);
+
+#ifdef OPENMP
+	#pragma omp parallel for private(i, j, p, r, rr, pair_ptr, erfc_term, gaussian_term, ef_i, ef_j) firstprivate(bigmess) schedule(static, 1)
+#endif
+	for(c = 0; c < nchunks; c++) {
+		for(i = thole_field_row(c, nchunks, N); i < thole_field_row(c + 1, nchunks, N); i++) {
+			if ( system->polar_frame_field && aa[i]->frozen ) continue; //the framework terms are cached
+			for(j = (i + 1), pair_ptr = PAIR_HEAD(system, aa[i]); pair_ptr; j++, pair_ptr = PAIR_NEXT(system, pair_ptr)) {
 
-				if ( molecule_ptr == pair_ptr->molecule ) continue; //don't let molecules polarize themselves
+				if ( system->neighbor_list ) j = pair_ptr->nlist_index;
+				if ( system->molecule_array[i] == pair_ptr->molecule ) continue; //don't let molecules polarize themselves
 				if ( pair_ptr->frozen ) continue; //don't let the MOF polarize itself
+				if ( system->polar_frame_field && pair_ptr->atom->frozen ) continue;
 
 				r = pair_ptr->rimg;
 
@@ -108,19 +423,23 @@ void thole_field_wolf(system_t *system) {
 					rr = 1./r;
 
 					//we will need this shit if wolf alpha != 0 
-					if ( (a != 0) & system->polar_wolf_alpha_lookup )
-						bigmess=polar_wolf_alpha_getval(system,r);
-					else if ( a != 0 ) //no lookup  
-						bigmess=(erfc(a*r)*rr*rr+2.0*a*OneOverSqrtPi*exp(-a*a*r*r)*rr);
+					if ( (a != 0) && system->polar_wolf_alpha_lookup && (r >= system->polar_wolf_alpha_lookup_cutoff) )
+						bigmess=0;
+					else if ( a != 0 ) {
+						ewald_table_eval(table, a, r, &erfc_term, &gaussian_term);
+						bigmess=(erfc_term*rr*rr+2.0*a*OneOverSqrtPi*gaussian_term*rr);
+					}
 
+					ef_i = buffer ? &(buffer[3*(c*N + i)]) : aa[i]->ef_static;
+					ef_j = buffer ? &(buffer[3*(c*N + j)]) : aa[j]->ef_static;
 					for ( p=0; p<3; p++ ) { 
 						//see JCP 124 (234104)
 						if ( a == 0 ) {
-							atom_ptr->ef_static[p] += (pair_ptr->atom->charge)*(rr*rr-rR*rR)*pair_ptr->dimg[p]*rr;
-							pair_ptr->atom->ef_static[p] -= (atom_ptr->charge)*(rr*rr-rR*rR)*pair_ptr->dimg[p]*rr;
+							ef_i[p] += (pair_ptr->atom->charge)*(rr*rr-rR*rR)*pair_ptr->dimg[p]*rr;
+							ef_j[p] -= (aa[i]->charge)*(rr*rr-rR*rR)*pair_ptr->dimg[p]*rr;
 						} else {
-							atom_ptr->ef_static[p] += pair_ptr->atom->charge*(bigmess-cutoffterm)*pair_ptr->dimg[p]*rr;
-							pair_ptr->atom->ef_static[p] -= atom_ptr->charge*(bigmess-cutoffterm)*pair_ptr->dimg[p]*rr;
+							ef_i[p] += pair_ptr->atom->charge*(bigmess-cutoffterm)*pair_ptr->dimg[p]*rr;
+							ef_j[p] -= aa[i]->charge*(bigmess-cutoffterm)*pair_ptr->dimg[p]*rr;
 						}
 					
 					}
@@ -128,8 +447,11 @@ void thole_field_wolf(system_t *system) {
 				} /* no lookup table */
 			} /* pair */
 		} /* atom */
-	} /* molecule */
+	} /* chunk */
+
+	thole_field_reduce(system, nchunks, buffer);
+
+	if ( system->polar_frame_field ) thole_frame_field(system, table, cutoffterm);
 
 	return;
 }
-
@@ -9,41 +9,145 @@ University of South Florida
 
 #include <mc.h>
 
+/* can the dipoles of the last accepted configuration seed this solve? */
+int polar_warm_ready ( system_t * system ) {
+	return system->polar_warm_start && system->checkpoint->dipoles_saved && system->checkpoint->move_pending;
+}
+
+/* keep the last accepted dipoles in saved_mu */
+void polar_warm_checkpoint ( system_t * system ) {
+	molecule_t * molecule_ptr;
+	atom_t * atom_ptr;
+
+	if ( !system->polar_warm_start ) return;
+
+	for ( molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next )
+		for ( atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next )
+			memcpy(atom_ptr->saved_mu, atom_ptr->mu, 3*sizeof(double));
+	system->checkpoint->dipoles_saved = 1;
+
+	return;
+}
+
+/* a rejected move leaves the trial dipoles behind, put the accepted ones back */
+void polar_warm_restore ( system_t * system ) {
+	molecule_t * molecule_ptr;
+	atom_t * atom_ptr;
+
+	if ( !system->polar_warm_start ) return;
+
+	for ( molecule_ptr = system->molecules; molecule_ptr; molecule_ptr = molecule_ptr->next )
+		for ( atom_ptr = molecule_ptr->atoms; atom_ptr; atom_ptr = atom_ptr->next )
+			memcpy(atom_ptr->mu, atom_ptr->saved_mu, 3*sizeof(double));
+
+	return;
+}
+
+/* ef -= the field of all the other dipoles at atom index, through its row of the A matrix */
+static void thole_row_field ( system_t * system, int index, double * ef ) {
+	int j, jj, k, p, ii = index*3;
+	atom_t ** aa = system->atom_array;
+	thole_sparse_t * A = system->A_sparse;
+	float * As;
+
+	if(system->polar_matrix_free) {
+		thole_matrix_free_field(system, index, ef);
+	} else if(system->polar_single_precision) {
+		//the stored tensors are float, the sums are kept in double
+		for(j = 0; j < system->natoms; j++) {
+			jj = j*3;
+			if(index != j)
+				for(p = 0; p < 3; p++) {
+					As = system->A_single[ii+p]+jj;
+					ef[p] -= As[0]*aa[j]->mu[0] + As[1]*aa[j]->mu[1] + As[2]*aa[j]->mu[2];
+				}
+		}
+	} else if(system->polar_sparse) {
+		for(k = A->row[index]; k < A->row[index+1]; k++) {
+			j = A->col[k];
+			if(index != j)
+				for(p = 0; p < 3; p++)
+					ef[p] -= dddotprod(A->block+9*k+3*p,aa[j]->mu);
+		}
+	} else {
+		for(j = 0; j < system->natoms; j++) {
+			jj = j*3;
+			if(index != j) 
+				for(p = 0; p < 3; p++)
+					ef[p] -= dddotprod((system->A_matrix[ii+p]+jj),aa[j]->mu);
+		} /* end j */
+	}
+
+	return;
+}
+
+/* first-order prediction of the dipoles of the molecule that was moved (or inserted): with every other */
+/* dipole held at its accepted value, each of its sites responds to the static field plus the induced */
+/* field of the rest, a gauss-seidel sweep over the molecule at a time */
+static void polar_predict ( system_t * system ) {
+	int i, p, sweep;
+	atom_t ** aa = system->atom_array;
+	double ef[3];
+
+	if(system->polar_matrix_free) thole_matrix_free_load(system, NULL);
+
+	for ( sweep=0; sweep<POLAR_PREDICT_SWEEPS; sweep++ ) {
+		for ( i=0; i<system->natoms; i++ ) {
+			if ( system->molecule_array[i] != system->checkpoint->molecule_altered ) continue;
+			if ( aa[i]->polarizability == 0 ) continue;
+
+			ef[0] = ef[1] = ef[2] = 0;
+			thole_row_field(system, i, ef);
+			for ( p=0; p<3; p++ )
+				aa[i]->mu[p] = aa[i]->polarizability*(aa[i]->ef_static[p] + aa[i]->ef_static_self[p] + ef[p]);
+			if ( system->polar_matrix_free ) thole_matrix_free_update(system, i);
+		}
+	}
+
+	return;
+}
+
 //set them to alpha*E_static
+//with polar_warm_start, only the molecule that was moved (or inserted) is reseeded, the rest keep their accepted dipoles
 void init_dipoles ( system_t * system ) {
 	int i, p;
 	atom_t ** aa = system->atom_array;
+	int warm = polar_warm_ready(system);
 
 	for ( i=0; i<system->natoms; i++ ) {
+		if ( warm && (system->molecule_array[i] != system->checkpoint->molecule_altered) ) continue;
 		for ( p=0; p<3; p++ ) {
 			aa[i]->mu[p] = aa[i]->polarizability*(aa[i]->ef_static[p]+aa[i]->ef_static_self[p]);
 			// should improve convergence since mu's typically grow as induced fields are added in
 			if (!system->polar_sor && !system->polar_esor) aa[i]->mu[p] *= system->polar_gamma; 
 		}
 	}
+
+	if ( warm && system->polar_predict ) polar_predict(system);
+
 	return;
 }
 
 
 void contract_dipoles ( system_t * system, int * ranked_array ) {
-	int i, j, ii, jj, p, index;
+	int i, p, index;
 	atom_t ** aa = system->atom_array;
 
+	if(system->polar_matrix_free) thole_matrix_free_load(system, NULL);
+
+	//the jacobi contraction only reads the old dipoles, so its rows can go to different threads
+#ifdef OPENMP
+	#pragma omp parallel for private(p, index) schedule(static) if(!(system->polar_gs || system->polar_gs_ranked))
+#endif
 	for(i = 0; i < system->natoms; i++) {
 		index = ranked_array[i]; //do them in the order of the ranked index
-		ii = index*3;
 		if ( aa[index]->polarizability == 0 ) { //if not polar
 			//aa[index]->ef_induced[p] is already 0
 			aa[index]->new_mu[0] = aa[index]->new_mu[1] = aa[index]->new_mu[2] = 0; //might be redundant?
 			aa[index]->mu[0] = aa[index]->mu[1] = aa[index]->mu[2] = 0; //might be redundant?
 			continue;
 		}	
-		for(j = 0; j < system->natoms; j++) {
-			jj = j*3;
-			if(index != j) 
-				for(p = 0; p < 3; p++)
-					aa[index]->ef_induced[p] -= dddotprod((system->A_matrix[ii+p]+jj),aa[j]->mu);
-		} /* end j */
+		thole_row_field(system, index, aa[index]->ef_induced);
 
 		/* dipole is the sum of the static and induced parts */
 		for(p = 0; p < 3; p++) {
@@ -53,6 +157,8 @@ void contract_dipoles ( system_t * system, int * ranked_array ) {
 			if(system->polar_gs || system->polar_gs_ranked)
 				aa[index]->mu[p] = aa[index]->new_mu[p];
 		}
+		if(system->polar_matrix_free && (system->polar_gs || system->polar_gs_ranked))
+			thole_matrix_free_update(system, index);
 
 	} /* end matrix multiply */
 
@@ -118,52 +224,397 @@ int are_we_done_yet ( system_t * system, int iteration_counter ) {
 }
 
 void palmo_contraction ( system_t * system, int * ranked_array ) {
-	int i, j, ii, jj, index, p;
+	int i, index, p;
 	int N = system->natoms;
 	atom_t ** aa = system->atom_array; 
 
+	if(system->polar_matrix_free) thole_matrix_free_load(system, NULL);
+
 	/* calculate change in induced field due to this iteration */
+#ifdef OPENMP
+	#pragma omp parallel for private(index, p) schedule(static)
+#endif
 	for(i = 0; i < N; i++) {
 		index = ranked_array[i];
-		ii = index*3;
 
 		for (p=0; p<3; p++ )
 			aa[index]->ef_induced_change[p] = -aa[index]->ef_induced[p];
 
-		for(j = 0; j < N; j++) {
-			jj = j*3;
-			if(index != j) 
-				for(p = 0; p < 3; p++)
-					aa[index]->ef_induced_change[p] -= dddotprod(system->A_matrix[ii+p]+jj,aa[j]->mu);
-		}
+		//the matrix-free rows only cover polar sites; the change is only ever dotted with mu, so nothing is lost
+		if(!system->polar_matrix_free || (aa[index]->polarizability != 0))
+			thole_row_field(system, index, aa[index]->ef_induced_change);
 	} 
 
 	return;
 }
 
-void update_ranking ( system_t * system, int * ranked_array ) {
-	int i, j, sorted, tmp;
-	int N = system->natoms; 
+/* the metrics (set in pairs()) are fixed within a solve and seldom change between steps, so the */
+/* last ordering is kept in system->polar_rank and only re-sorted once it no longer holds */
+/* sites go by decreasing metric, ties in atom order, as the bubble sort used to leave them */
+static int polar_rank_valid ( system_t * system ) {
+	int k, a, b;
+	atom_t ** aa = system->atom_array;
+
+	if ( !system->polar_rank || (system->polar_rank_N != system->natoms) ) return 0;
+
+	for ( k=0; k<(system->natoms-1); k++ ) {
+		a = system->polar_rank[k];
+		b = system->polar_rank[k+1];
+		if ( aa[a]->rank_metric < aa[b]->rank_metric ) return 0;
+		if ( (aa[a]->rank_metric == aa[b]->rank_metric) && (a > b) ) return 0;
+	}
+
+	return 1;
+}
+
+/* stable counting sort on the metric, which is a count of close neighbors */
+static void polar_rank_sort ( system_t * system ) {
+	int i, k, nbins;
+	int N = system->natoms;
 	atom_t ** aa = system->atom_array;
+	int * start;
+
+	if ( system->polar_rank_N != N ) {
+		free(system->polar_rank);
+		system->polar_rank = calloc(N, sizeof(int));
+		memnullcheck(system->polar_rank,N*sizeof(int),__LINE__-1, __FILE__);
+		system->polar_rank_N = N;
+	}
+
+	for ( i=0, nbins=1; i<N; i++ )
+		if ( (int)aa[i]->rank_metric + 1 > nbins ) nbins = (int)aa[i]->rank_metric + 1;
+
+	start = calloc(nbins+1, sizeof(int));
+	memnullcheck(start,(nbins+1)*sizeof(int),__LINE__-1, __FILE__);
+
+	/* bins run from the largest metric down */
+	for ( i=0; i<N; i++ )
+		start[nbins - (int)aa[i]->rank_metric]++;
+	for ( k=1; k<=nbins; k++ )
+		start[k] += start[k-1];
+	for ( i=0; i<N; i++ )
+		system->polar_rank[start[nbins - 1 - (int)aa[i]->rank_metric]++] = i;
+
+	free(start);
+
+	return;
+}
+
+void update_ranking ( system_t * system, int * ranked_array ) {
 
-	/* rank the dipoles by bubble sort */
 	if(system->polar_gs_ranked) {
-		for(i = 0; i < N; i++) {
-			for(j = 0, sorted = 1; j < (N-1); j++) {
-				if(aa[ranked_array[j]]->rank_metric < aa[ranked_array[j+1]]->rank_metric) {
-					sorted = 0;
-					tmp = ranked_array[j];
-					ranked_array[j] = ranked_array[j+1];
-					ranked_array[j+1] = tmp;
-				}
+		if ( !polar_rank_valid(system) )
+			polar_rank_sort(system);
+		memcpy(ranked_array, system->polar_rank, system->natoms*sizeof(int));
+	}
+
+	return;
+}
+
+
+/* the 3x3 diagonal block of site i, row-major */
+static void thole_cg_diagonal ( system_t * system, int i, double * blk ) {
+	int p, q;
+
+	if ( system->polar_matrix_free ) {
+		thole_amatrix_diagonal(system->atom_array[i], blk);
+		return;
+	}
+
+	for ( p=0; p<3; p++ )
+		for ( q=0; q<3; q++ )
+			if ( system->polar_sparse )
+				blk[3*p+q] = system->A_sparse->block[9*system->A_sparse->row[i]+3*p+q]; //the diagonal leads the row
+			else if ( system->polar_single_precision )
+				blk[3*p+q] = system->A_single[3*i+p][3*i+q];
+			else
+				blk[3*p+q] = system->A_matrix[3*i+p][3*i+q];
+
+	return;
+}
+
+/* invert the 3x3 diagonal block of site i (block-Jacobi preconditioner) */
+static void thole_cg_block_inverse ( system_t * system, int i, double * inv ) {
+	double A[9];
+	double det;
+	int k;
+
+	thole_cg_diagonal(system, i, A);
+
+	inv[0] = A[4]*A[8] - A[5]*A[7];
+	inv[1] = A[2]*A[7] - A[1]*A[8];
+	inv[2] = A[1]*A[5] - A[2]*A[4];
+	inv[3] = A[5]*A[6] - A[3]*A[8];
+	inv[4] = A[0]*A[8] - A[2]*A[6];
+	inv[5] = A[2]*A[3] - A[0]*A[5];
+	inv[6] = A[3]*A[7] - A[4]*A[6];
+	inv[7] = A[1]*A[6] - A[0]*A[7];
+	inv[8] = A[0]*A[4] - A[1]*A[3];
+
+	det = A[0]*inv[0] + A[1]*inv[3] + A[2]*inv[6];
+	for ( k=0; k<9; k++ ) inv[k] /= det;
+
+	return;
+}
+
+/* out = A*in over the polarizable sites; non-polar sites are held at zero */
+static void thole_cg_matvec ( system_t * system, double * in, double * out ) {
+	int i, j, k, p, N = 3*system->natoms;
+	atom_t ** aa = system->atom_array;
+	thole_sparse_t * A = system->A_sparse;
+	double sum;
+
+	if ( system->polar_matrix_free ) {
+		thole_matrix_free_load(system, in);
+#ifdef OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for ( i=0; i<system->natoms; i++ ) {
+			if ( aa[i]->polarizability == 0 ) {
+				out[3*i] = out[3*i+1] = out[3*i+2] = 0;
+				continue;
+			}
+			thole_matrix_free_matvec(system, i, out+3*i);
+		}
+		return;
+	}
+
+	if ( system->polar_sparse ) {
+#ifdef OPENMP
+		#pragma omp parallel for private(j, k, p) schedule(static)
+#endif
+		for ( i=0; i<system->natoms; i++ ) {
+			out[3*i] = out[3*i+1] = out[3*i+2] = 0;
+			if ( aa[i]->polarizability == 0 ) continue;
+			for ( k=A->row[i]; k<A->row[i+1]; k++ ) {
+				j = A->col[k];
+				for ( p=0; p<3; p++ )
+					out[3*i+p] += dddotprod(A->block+9*k+3*p, in+3*j);
 			}
-			if(sorted) break;
 		}
+		return;
 	}
 
+#ifdef OPENMP
+	#pragma omp parallel for private(j, sum) schedule(static)
+#endif
+	for ( i=0; i<N; i++ ) {
+		if ( aa[i/3]->polarizability == 0 ) {
+			out[i] = 0;
+			continue;
+		}
+		sum = 0;
+		if ( system->polar_single_precision )
+			for ( j=0; j<N; j++ )
+				sum += system->A_single[i][j]*in[j];
+		else
+			for ( j=0; j<N; j++ )
+				sum += system->A_matrix[i][j]*in[j];
+		out[i] = sum;
+	}
+
+	return;
+}
+
+//kept serial: a threaded reduction would make the sum (and so the dipoles) depend on the thread count
+static double thole_cg_dot ( int N, double * x, double * y ) {
+	int i;
+	double sum = 0;
+
+	for ( i=0; i<N; i++ ) sum += x[i]*y[i];
+
+	return sum;
+}
+
+static void thole_cg_precondition ( system_t * system, double * Minv, double * in, double * out ) {
+	int i, p;
+
+#ifdef OPENMP
+	#pragma omp parallel for private(p) schedule(static)
+#endif
+	for ( i=0; i<system->natoms; i++ )
+		for ( p=0; p<3; p++ )
+			out[3*i+p] = dddotprod(Minv+9*i+3*p, in+3*i);
+
 	return;
 }
 
+/* preconditioned conjugate gradient solution of A mu = E, with a 3x3 block-Jacobi preconditioner */
+/* the A matrix is symmetric positive-definite, so unlike the fixed-point schemes this can't oscillate */
+/* convergence is judged by are_we_done_yet() on the change in the dipoles, as for the other schemes */
+static int thole_cg ( system_t * system ) {
+
+	int i, p, N, iteration_counter, keep_iterating;
+	atom_t ** aa = system->atom_array;
+	double *b, *r, *z, *d, *q, *Minv;
+	double rz, rz_new, dq, step;
+
+	N = system->natoms;
+
+	b = calloc(3*N, sizeof(double));
+	memnullcheck(b,3*N*sizeof(double),__LINE__-1, __FILE__);
+	r = calloc(3*N, sizeof(double));
+	memnullcheck(r,3*N*sizeof(double),__LINE__-1, __FILE__);
+	z = calloc(3*N, sizeof(double));
+	memnullcheck(z,3*N*sizeof(double),__LINE__-1, __FILE__);
+	d = calloc(3*N, sizeof(double));
+	memnullcheck(d,3*N*sizeof(double),__LINE__-1, __FILE__);
+	q = calloc(3*N, sizeof(double));
+	memnullcheck(q,3*N*sizeof(double),__LINE__-1, __FILE__);
+	Minv = calloc(9*N, sizeof(double));
+	memnullcheck(Minv,9*N*sizeof(double),__LINE__-1, __FILE__);
+
+	/* right hand side and preconditioner; non-polar sites are left out of the problem */
+	for ( i=0; i<N; i++ ) {
+		if ( aa[i]->polarizability == 0 ) continue;
+		for ( p=0; p<3; p++ )
+			b[3*i+p] = aa[i]->ef_static[p] + aa[i]->ef_static_self[p];
+		thole_cg_block_inverse(system, i, Minv+9*i);
+	}
+
+	/* start from the preconditioned field (alpha*E for isotropic sites), or from the accepted dipoles */
+	if ( polar_warm_ready(system) )
+		init_dipoles(system);
+	else {
+		thole_cg_precondition(system, Minv, b, z);
+		for ( i=0; i<N; i++ )
+			for ( p=0; p<3; p++ )
+				aa[i]->mu[p] = z[3*i+p];
+	}
+	for ( i=0; i<N; i++ )
+		for ( p=0; p<3; p++ )
+			z[3*i+p] = (aa[i]->polarizability == 0) ? 0 : aa[i]->mu[p];
+
+	thole_cg_matvec(system, z, q);
+	for ( i=0; i<3*N; i++ ) r[i] = b[i] - q[i];
+	thole_cg_precondition(system, Minv, r, z);
+	memcpy(d, z, 3*N*sizeof(double));
+	rz = thole_cg_dot(3*N, r, z);
+
+	keep_iterating = 1;
+	iteration_counter = 0;
+	while ( keep_iterating ) {
+		iteration_counter++;
+
+		thole_cg_matvec(system, d, q);
+		dq = thole_cg_dot(3*N, d, q);
+
+		/* divergence detection (or a matrix that isn't positive-definite) */
+		/* if we fail to converge, then return dipoles as alpha*E */
+		if( (iteration_counter >= MAX_ITERATION_COUNT && system->polar_precision) || !(dq > 0) ) {
+			for(i = 0; i < N; i++)
+				for(p = 0; p < 3; p++) {
+					aa[i]->mu[p] = aa[i]->polarizability * (aa[i]->ef_static[p] + aa[i]->ef_static_self[p]);
+					aa[i]->ef_induced_change[p] = 0.0; //so we don't break palmo
+				}
+			//set convergence failure flag
+			system->iter_success = 1;
+			break;
+		}
+
+		step = rz/dq;
+		for ( i=0; i<N; i++ ) {
+			for ( p=0; p<3; p++ ) {
+				aa[i]->old_mu[p] = aa[i]->mu[p];
+				aa[i]->new_mu[p] = aa[i]->mu[p] = aa[i]->mu[p] + step*d[3*i+p];
+				r[3*i+p] -= step*q[3*i+p];
+			}
+		}
+
+		if ( system->polar_rrms || system->polar_precision > 0 )
+			calc_dipole_rrms(system);
+
+		/* determine if we are done... */
+		keep_iterating = are_we_done_yet(system, iteration_counter);
+		if ( !keep_iterating ) break;
+
+		thole_cg_precondition(system, Minv, r, z);
+		rz_new = thole_cg_dot(3*N, r, z);
+		for ( i=0; i<3*N; i++ ) d[i] = z[i] + (rz_new/rz)*d[i];
+		rz = rz_new;
+	}
+
+	/* induced field of the final dipoles; what is left of the residual is the palmo correction */
+	if ( !system->iter_success ) {
+		for ( i=0; i<N; i++ )
+			for ( p=0; p<3; p++ )
+				d[3*i+p] = aa[i]->mu[p];
+		thole_cg_matvec(system, d, q);
+		for ( i=0; i<N; i++ ) {
+			thole_cg_diagonal(system, i, Minv); //Minv is spent, reuse it for the diagonal block
+			for ( p=0; p<3; p++ ) {
+				if ( aa[i]->polarizability == 0 ) {
+					aa[i]->ef_induced[p] = aa[i]->ef_induced_change[p] = 0;
+					continue;
+				}
+				aa[i]->ef_induced[p] = -(q[3*i+p] - dddotprod(Minv+3*p, aa[i]->mu));
+				aa[i]->ef_induced_change[p] = b[3*i+p] - q[3*i+p];
+			}
+		}
+	}
+
+	free(b);
+	free(r);
+	free(z);
+	free(d);
+	free(q);
+	free(Minv);
+
+	return(iteration_counter);
+}
+
+/* with the A matrix in single precision, the converged dipoles are polished by gauss-seidel sweeps */
+/* whose induced field is evaluated in double, tensor by tensor, until no dipole component moves by */
+/* more than polar_precision; the largest correction of the first sweep (the error left by the float */
+/* matrix) is kept as an observable and reported with the polarization energy */
+/* the induced field and the palmo correction are then those of the refined dipoles, in double too */
+static void thole_refine ( system_t * system ) {
+	int i, p, sweep;
+	atom_t ** aa = system->atom_array;
+	double ef[3], new_mu, error, max_sqerr, allowed_sqerr;
+
+	allowed_sqerr = system->polar_precision*system->polar_precision*DEBYE2SKA*DEBYE2SKA;
+
+	thole_matrix_free_load(system, NULL);
+
+	for ( sweep=0; sweep<POLAR_REFINE_SWEEPS; sweep++ ) {
+		max_sqerr = 0;
+		for ( i=0; i<system->natoms; i++ ) {
+			if ( aa[i]->polarizability == 0 ) continue;
+
+			ef[0] = ef[1] = ef[2] = 0;
+			thole_matrix_free_field(system, i, ef);
+			for ( p=0; p<3; p++ ) {
+				new_mu = aa[i]->polarizability*(aa[i]->ef_static[p] + aa[i]->ef_static_self[p] + ef[p]);
+				error = new_mu - aa[i]->mu[p];
+				if ( error*error > max_sqerr ) max_sqerr = error*error;
+				aa[i]->mu[p] = new_mu;
+			}
+			thole_matrix_free_update(system, i);
+		}
+
+		if ( !sweep ) system->observables->dipole_refine = sqrt(max_sqerr)/DEBYE2SKA;
+		if ( max_sqerr <= allowed_sqerr ) break;
+	}
+
+	//the solver left the float matrix's residual in ef_induced_change; replace it with the double one
+	for ( i=0; i<system->natoms; i++ ) {
+		if ( aa[i]->polarizability == 0 ) {
+			for ( p=0; p<3; p++ )
+				aa[i]->ef_induced[p] = aa[i]->ef_induced_change[p] = 0;
+			continue;
+		}
+
+		ef[0] = ef[1] = ef[2] = 0;
+		thole_matrix_free_field(system, i, ef);
+		for ( p=0; p<3; p++ ) {
+			aa[i]->ef_induced[p] = ef[p];
+			aa[i]->ef_induced_change[p] = aa[i]->ef_static[p] + aa[i]->ef_static_self[p] + ef[p] - aa[i]->mu[p]/aa[i]->polarizability;
+		}
+	}
+
+	return;
+}
 
 /* iterative solver of the dipole field tensor */
 /* returns the number of iterations required */
@@ -174,6 +625,12 @@ int thole_iterative(system_t *system) {
 	atom_t ** aa; //atom array
 	int *ranked_array;
 
+	if(system->polar_solver == POLAR_SOLVER_CG) {
+		iteration_counter = thole_cg(system);
+		if(system->polar_single_precision && !system->iter_success) thole_refine(system);
+		return(iteration_counter);
+	}
+
 	aa = system->atom_array;
 	N = system->natoms;
 
@@ -257,6 +714,8 @@ int thole_iterative(system_t *system) {
 	} //end iterate
 	free(ranked_array);
 
+	if(system->polar_single_precision) thole_refine(system);
+
 	/* return the iteration count */
 	return(iteration_counter);
 }
@@ -26,18 +26,19 @@ void print_matrix(int N, double **matrix) {
 void zero_out_amatrix ( system_t * system, int N ) {
 	int i, j;
 	/* zero out the matrix */
+#ifdef OPENMP
+	#pragma omp parallel for private(j) schedule(static)
+#endif
 	for(i = 0; i < 3*N; i++)
 		for(j = 0; j < 3*N; j++)
 			system->A_matrix[i][j] = 0;
 	return;
 }
 	
-/* calculate the dipole field tensor */
-void thole_amatrix(system_t *system) {
+/* the 3x3 dipole field tensor block between atoms i and j, row-major */
+static void thole_amatrix_block(system_t *system, atom_t **atom_array, int i, int j, pair_t *pair_ptr, double *block) {
 
-	int i, j, ii, jj, N, p, q;
-	atom_t **atom_array;
-	pair_t *pair_ptr;
+	int p, q;
 	double damp1=0, damp2=0, wdamp1=0, wdamp2=0, v, s;
 	double r, r2, ir3, ir5, ir=0;
 	double rcut, rcut2, rcut3;
@@ -47,94 +48,503 @@ void thole_amatrix(system_t *system) {
 	l = system->polar_damp;
 	l2 = l*l; l3 = l2*l;
 	double explr; //exp(-l*r)
-	double explrcut = exp(-l*rcut);
+	double explrcut;
+
+	r = pair_ptr->rimg;
+	r2 = r*r;
+
+	/* inverse displacements */
+	if(pair_ptr->rimg == 0.)
+		ir3 = ir5 = MAXVALUE;
+	else {
+		ir = 1.0/r;
+		ir3 = ir*ir*ir;
+		ir5 = ir3*ir*ir;
+	}
+
+	//evaluate damping factors
+	switch (system->damp_type) {
+		case DAMPING_OFF:
+			if ( pair_ptr->es_excluded )
+				damp1 = damp2 = wdamp1 = wdamp2 = 0.0; 
+			else 
+				damp1 = damp2 = wdamp1 = wdamp2 = 1.0; 
+			break;
+		case DAMPING_LINEAR:
+			s = l * pow(atom_array[i]->polarizability*atom_array[j]->polarizability, 1.0/6.0);
+			v = r/s;
+			if ( r < s ) {
+				damp1 = (4.0 - 3.0*v)*v*v*v;
+				damp2 = v*v*v*v;
+			} else {
+				damp1 = damp2 = 1.0;
+			}
+			break;
+		case DAMPING_EXPONENTIAL:
+			explr = exp(-l*r);
+			damp1 = 1.0 - explr*(0.5*l2*r2 + l*r + 1.0);
+			damp2 = damp1 - explr*(l3*r2*r/6.0);
+			if ( system->polar_wolf_full ) { //subtract off damped interaction at r_cutoff
+				explrcut = exp(-l*rcut);
+				wdamp1 = 1.0 - explrcut*(0.5*l2*rcut2+l*rcut+1.0);
+				wdamp2 = wdamp1 - explrcut*(l3*rcut3/6.0);
+			}
+			break;
+		default:
+			error("error: something unexpected happened in thole_matrix.c");
+	}
+
+	/* build the tensor */
+	for(p = 0; p < 3; p++) {
+		for(q = 0; q < 3; q++) {
+
+			block[3*p+q] = -3.0*pair_ptr->dimg[p]*pair_ptr->dimg[q]*damp2*ir5;
+			if (system->polar_wolf_full) 
+				block[3*p+q] -= -3.0*pair_ptr->dimg[p]*pair_ptr->dimg[q]*wdamp2*ir*ir/rcut3;
+
+			/* additional diagonal term */
+			if(p == q) {
+				block[3*p+q] += damp1*ir3;
+				if ( system->polar_wolf_full ) block[3*p+q] -= wdamp1/(rcut3);
+			}	
+		}
+	}
+
+	return;
+}
+
+/* the 3x3 diagonal block of atom i */
+void thole_amatrix_diagonal(atom_t *atom_ptr, double *block) {
+
+	int p;
+
+	for(p = 0; p < 9; p++) block[p] = 0;
+	for(p = 0; p < 3; p++) {
+		if(atom_ptr->polarizability != 0.0)
+			block[4*p] = 1.0/atom_ptr->polarizability;
+		else
+			block[4*p] = MAXVALUE;
+	}
+
+	return;
+}
+
+/* cutoff-truncated A matrix in 3x3 block compressed rows */
+/* only pairs of polarizable atoms inside the cutoff are stored, so memory and */
+/* each contraction go as N times the number of neighbors instead of N^2 */
+static void thole_amatrix_sparse(system_t *system) {
+
+	int i, j, k, N, nblocks;
+	atom_t **atom_array = system->atom_array;
+	pair_t *pair_ptr;
+	thole_sparse_t *A;
+	int *cursor;
 
-	//array of atoms generated in pairs.c
-	atom_array = system->atom_array;
 	N = system->natoms;
 
-	zero_out_amatrix(system,N);
+	if(!system->A_sparse) {
+		system->A_sparse = calloc(1, sizeof(thole_sparse_t));
+		memnullcheck(system->A_sparse, sizeof(thole_sparse_t), __LINE__-1, __FILE__);
+	}
+	A = system->A_sparse;
 
-	/* set the diagonal blocks */
+	if(N > A->N) {
+		free(A->row);
+		A->row = calloc(N+1, sizeof(int));
+		memnullcheck(A->row, (N+1)*sizeof(int), __LINE__-1, __FILE__);
+	}
+	A->N = N;
+
+	cursor = calloc(N, sizeof(int));
+	memnullcheck(cursor, N*sizeof(int), __LINE__-1, __FILE__);
+
+	/* count the blocks in each row: the diagonal plus the neighbors */
+	for(i = 0; i < N; i++) cursor[i] = 1;
+	for(i = 0; i < (N - 1); i++) {
+		if(atom_array[i]->polarizability == 0.0) continue;
+		for(j = (i + 1), pair_ptr = atom_array[i]->pairs; j < N; j++, pair_ptr = pair_ptr->next) {
+			if(atom_array[j]->polarizability == 0.0) continue;
+			if(pair_ptr->rimg - SMALL_dR >= system->pbc->cutoff) continue;
+			cursor[i]++;
+			cursor[j]++;
+		}
+	}
+
+	A->row[0] = 0;
+	for(i = 0; i < N; i++) A->row[i+1] = A->row[i] + cursor[i];
+	nblocks = A->row[N];
+
+	if(nblocks > A->max_blocks) {
+		A->max_blocks = nblocks;
+		free(A->col);
+		free(A->block);
+		A->col = calloc(nblocks, sizeof(int));
+		memnullcheck(A->col, nblocks*sizeof(int), __LINE__-1, __FILE__);
+		A->block = calloc(9*nblocks, sizeof(double));
+		memnullcheck(A->block, 9*nblocks*sizeof(double), __LINE__-1, __FILE__);
+	}
+	A->nblocks = nblocks;
+
+	/* the diagonal block leads each row */
 	for(i = 0; i < N; i++) {
-		ii = i*3;
-		for(p = 0; p < 3; p++) {
-			if(atom_array[i]->polarizability != 0.0)
-				system->A_matrix[ii+p][ii+p] = 1.0/atom_array[i]->polarizability;
-			else
-				system->A_matrix[ii+p][ii+p] = MAXVALUE;
+		k = A->row[i];
+		A->col[k] = i;
+		thole_amatrix_diagonal(atom_array[i], A->block + 9*k);
+		cursor[i] = k + 1;
+	}
+
+	/* each tensor is stored in both rows (it is symmetric) */
+	for(i = 0; i < (N - 1); i++) {
+		if(atom_array[i]->polarizability == 0.0) continue;
+		for(j = (i + 1), pair_ptr = atom_array[i]->pairs; j < N; j++, pair_ptr = pair_ptr->next) {
+			if(atom_array[j]->polarizability == 0.0) continue;
+			if(pair_ptr->rimg - SMALL_dR >= system->pbc->cutoff) continue;
+
+			k = cursor[i]++;
+			A->col[k] = j;
+			thole_amatrix_block(system, atom_array, i, j, pair_ptr, A->block + 9*k);
+
+			A->col[cursor[j]] = i;
+			memcpy(A->block + 9*cursor[j], A->block + 9*k, 9*sizeof(double));
+			cursor[j]++;
 		}
 	}
 
-	/* calculate each Tij tensor component for each dipole pair */
+	free(cursor);
+
+	return;
+}
+
+/* leading dimension for n rows and columns of elements of the given size: some headroom when N */
+/* can fluctuate (ensembles with a fixed N get none), rounded up so that every row starts aligned */
+static int thole_matrix_ld(system_t *system, int n, size_t size) {
+
+	int ld = n, align = THOLE_MATRIX_ALIGN/size;
+
+	if((system->ensemble == ENSEMBLE_UVT) || (system->ensemble == ENSEMBLE_REPLAY)) ld += n/8 + 24;
+	ld += (align - ld%align)%align;
+
+	return ld;
+}
+
+/* an aligned ld x ld block */
+static void *thole_matrix_alloc(int ld, size_t size) {
+
+	void *block;
+
+	size *= (size_t)ld*ld;
+	if(posix_memalign(&block, THOLE_MATRIX_ALIGN, size)) block = NULL;
+	memnullcheck(block, size, __LINE__-1, __FILE__);
+
+	return block;
+}
+
+/* make room for n rows and columns in a matrix kept as one aligned block, with row pointers into it */
+/* the leading dimension grows geometrically and never shrinks, so a uvt run reuses the block across */
+/* insertions and removals; with keep set, the contents of each row (wherever it points) are carried over */
+static void thole_matrix_reserve(system_t *system, double ***rows, double **block, int *ld, int n, int keep) {
+
+	int i, ld_new;
+	double *block_new;
+
+	if(n <= *ld) return;
+
+	ld_new = thole_matrix_ld(system, n, sizeof(double));
+	block_new = thole_matrix_alloc(ld_new, sizeof(double));
+
+	if(keep)
+		for(i = 0; i < *ld; i++)
+			memcpy(block_new + (size_t)i*ld_new, (*rows)[i], (*ld)*sizeof(double));
+	free(*block);
+
+	*rows = realloc(*rows, ld_new*sizeof(double *));
+	memnullcheck(*rows, ld_new*sizeof(double *), __LINE__-1, __FILE__);
+	for(i = 0; i < ld_new; i++)
+		(*rows)[i] = block_new + (size_t)i*ld_new;
+
+	*block = block_new;
+	*ld = ld_new;
+
+	return;
+}
+
+/* the same for the single precision A matrix, whose contents are always rebuilt */
+static void thole_matrix_reserve_single(system_t *system, int n) {
+
+	int i, ld;
+
+	if(n <= system->A_single_ld) return;
+
+	ld = thole_matrix_ld(system, n, sizeof(float));
+	free(system->A_single_block);
+	system->A_single_block = thole_matrix_alloc(ld, sizeof(float));
+
+	system->A_single = realloc(system->A_single, ld*sizeof(float *));
+	memnullcheck(system->A_single, ld*sizeof(float *), __LINE__-1, __FILE__);
+	for(i = 0; i < ld; i++)
+		system->A_single[i] = system->A_single_block + (size_t)i*ld;
+
+	system->A_single_ld = ld;
+
+	return;
+}
+
+/* the A matrix in single precision: each tensor is still evaluated in double, and only stored as */
+/* float, which halves the memory of the matrix and the bandwidth of every contraction through it */
+static void thole_amatrix_single(system_t *system) {
+
+	int i, j, ii, jj, N, p, q;
+	atom_t **atom_array = system->atom_array;
+	pair_t *pair_ptr;
+	double block[9];
+	float **A;
+
+	N = system->natoms;
+	thole_matrix_reserve_single(system, 3*N);
+	A = system->A_single;
+
+#ifdef OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for(i = 0; i < 3*N; i++)
+		memset(A[i], 0, 3*N*sizeof(float));
+
+	for(i = 0; i < N; i++) {
+		ii = i*3;
+		thole_amatrix_diagonal(atom_array[i], block);
+		for(p = 0; p < 3; p++)
+			A[ii+p][ii+p] = (float)block[4*p];
+	}
+
+#ifdef OPENMP
+	#pragma omp parallel for private(j, ii, jj, p, q, pair_ptr, block) schedule(dynamic)
+#endif
 	for(i = 0; i < (N - 1); i++) {
 		ii = i*3;
 		for(j = (i + 1), pair_ptr = atom_array[i]->pairs; j < N; j++, pair_ptr = pair_ptr->next) {
 			jj = j*3;
 
-			r = pair_ptr->rimg;
-			r2 = r*r;
+			thole_amatrix_block(system, atom_array, i, j, pair_ptr, block);
 
-			/* inverse displacements */
-			if(pair_ptr->rimg == 0.)
-				ir3 = ir5 = MAXVALUE;
-			else {
-				ir = 1.0/r;
-				ir3 = ir*ir*ir;
-				ir5 = ir3*ir*ir;
+			for(p = 0; p < 3; p++) {
+				for(q = 0; q < 3; q++) {
+					A[ii+p][jj+q] = (float)block[3*p+q];
+					A[jj+p][ii+q] = (float)block[3*p+q];
+				}
 			}
+		}
+	}
 
-			//evaluate damping factors
-			switch (system->damp_type) {
-				case DAMPING_OFF:
-					if ( pair_ptr->es_excluded )
-						damp1 = damp2 = wdamp1 = wdamp2 = 0.0; 
-					else 
-						damp1 = damp2 = wdamp1 = wdamp2 = 1.0; 
-					break;
-				case DAMPING_LINEAR:
-					s = l * pow(atom_array[i]->polarizability*atom_array[j]->polarizability, 1.0/6.0);
-					v = r/s;
-					if ( r < s ) {
-						damp1 = (4.0 - 3.0*v)*v*v*v;
-						damp2 = v*v*v*v;
-					} else {
-						damp1 = damp2 = 1.0;
-					}
-					break;
-				case DAMPING_EXPONENTIAL:
-					explr = exp(-l*r);
-					damp1 = 1.0 - explr*(0.5*l2*r2 + l*r + 1.0);
-					damp2 = damp1 - explr*(l3*r2*r/6.0);
-					if ( system->polar_wolf_full ) { //subtract off damped interaction at r_cutoff
-						wdamp1 = 1.0 - explrcut*(0.5*l2*rcut2+l*rcut+1.0);
-						wdamp2 = wdamp1 - explrcut*(l3*rcut3/6.0);
-					}
-					break;
-				default:
-					error("error: something unexpected happened in thole_matrix.c");
+	return;
+}
+
+/* make room for N atoms in the persistent A matrix; rows keep their contents */
+static void thole_incremental_grow(system_t *system, int N) {
+
+	int capacity;
+	thole_incremental_t *inc = system->A_incremental;
+
+	thole_matrix_reserve(system, &system->A_matrix, &system->A_block, &system->A_ld, 3*N, 1);
+
+	capacity = system->A_ld/3;
+	if(capacity <= inc->capacity) return;
+
+	inc->atoms = realloc(inc->atoms, capacity*sizeof(atom_t *));
+	memnullcheck(inc->atoms, capacity*sizeof(atom_t *), __LINE__-1, __FILE__);
+	inc->pos = realloc(inc->pos, 3*capacity*sizeof(double));
+	memnullcheck(inc->pos, 3*capacity*sizeof(double), __LINE__-1, __FILE__);
+	inc->polarizability = realloc(inc->polarizability, capacity*sizeof(double));
+	memnullcheck(inc->polarizability, capacity*sizeof(double), __LINE__-1, __FILE__);
+	inc->map = realloc(inc->map, capacity*sizeof(int));
+	memnullcheck(inc->map, capacity*sizeof(int), __LINE__-1, __FILE__);
+	inc->dirty = realloc(inc->dirty, capacity*sizeof(int));
+	memnullcheck(inc->dirty, capacity*sizeof(int), __LINE__-1, __FILE__);
+	inc->used = realloc(inc->used, capacity*sizeof(int));
+	memnullcheck(inc->used, capacity*sizeof(int), __LINE__-1, __FILE__);
+	inc->scratch = realloc(inc->scratch, 3*capacity*sizeof(double));
+	memnullcheck(inc->scratch, 3*capacity*sizeof(double), __LINE__-1, __FILE__);
+	inc->rows = realloc(inc->rows, 3*capacity*sizeof(double *));
+	memnullcheck(inc->rows, 3*capacity*sizeof(double *), __LINE__-1, __FILE__);
+
+	inc->capacity = capacity;
+
+	return;
+}
+
+/* patch the A matrix left by the last call, instead of rebuilding it */
+/* atoms are matched to their old row block through atom->thole_index; blocks are recomputed */
+/* only where an atom is new or has moved, and the rows/columns of the survivors are shuffled */
+/* into place when a molecule was inserted or removed ahead of them */
+static void thole_amatrix_incremental(system_t *system) {
+
+	int i, j, k, p, q, N, oldN, first, last, full, nfree;
+	atom_t **atom_array = system->atom_array;
+	pair_t *pair_ptr;
+	thole_incremental_t *inc;
+	double block[9], **A;
+
+	N = system->natoms;
+
+	if(!system->A_incremental) {
+		system->A_incremental = calloc(1, sizeof(thole_incremental_t));
+		memnullcheck(system->A_incremental, sizeof(thole_incremental_t), __LINE__-1, __FILE__);
+	}
+	inc = system->A_incremental;
+	oldN = inc->N;
+
+	thole_incremental_grow(system, N);
+	A = system->A_matrix;
+
+	/* a new cell changes every minimum image */
+	full = (oldN == 0) || memcmp(inc->basis, system->pbc->basis, sizeof(inc->basis));
+
+	/* find where each atom was, and whether it needs new blocks */
+	first = N;
+	for(i = 0; i < N; i++) {
+		k = atom_array[i]->thole_index - 1;
+		if(full || (k < 0) || (k >= oldN) || (inc->atoms[k] != atom_array[i])) 
+			k = -1;
+		inc->map[i] = k;
+		inc->dirty[i] = (k < 0) || (inc->polarizability[k] != atom_array[i]->polarizability) || memcmp(&(inc->pos[3*k]), atom_array[i]->pos, 3*sizeof(double));
+		if((k != i) && (first == N)) first = i;
+	}
+
+	/* an insertion or removal shifts everything after it: move the surviving row blocks first... */
+	if(!full && (first < N)) {
+		for(i = 3*first; i < 3*inc->capacity; i++) inc->rows[i] = NULL;
+		for(k = first; k < oldN; k++) inc->used[k] = 0;
+		for(i = first; i < N; i++) {
+			if(inc->map[i] < 0) continue;
+			inc->used[inc->map[i]] = 1;
+			for(p = 0; p < 3; p++)
+				inc->rows[3*i+p] = A[3*inc->map[i]+p];
+		}
+		/* ...the rows of the atoms that are gone (and the spare ones) go to the new ones */
+		for(nfree = 3*first, i = 3*first; i < 3*inc->capacity; i++) {
+			if((i < 3*oldN) && inc->used[i/3]) continue;
+			while(inc->rows[nfree]) nfree++;
+			inc->rows[nfree] = A[i];
+		}
+		memcpy(&(A[3*first]), &(inc->rows[3*first]), 3*(inc->capacity - first)*sizeof(double *));
+
+		/* ...then the surviving column blocks of every row */
+		for(i = 0; i < N; i++) {
+			if(inc->map[i] < 0) continue;
+			for(p = 0; p < 3; p++) {
+				memcpy(&(inc->scratch[3*first]), &(A[3*i+p][3*first]), 3*(oldN - first)*sizeof(double));
+				for(j = first; j < N; j++)
+					if(inc->map[j] >= 0)
+						for(q = 0; q < 3; q++)
+							A[3*i+p][3*j+q] = inc->scratch[3*inc->map[j]+q];
 			}
+		}
+	}
 
-			/* build the tensor */
+	/* recompute the blocks that involve a new or moved atom */
+	for(last = -1, i = 0; i < N; i++) {
+		if(full) inc->dirty[i] = 1;
+		if(inc->dirty[i]) {
+			last = i;
+			thole_amatrix_diagonal(atom_array[i], block);
 			for(p = 0; p < 3; p++) {
-				for(q = 0; q < 3; q++) {
+				for(q = 0; q < 3; q++)
+					A[3*i+p][3*i+q] = block[3*p+q];
+			}
+		}
+	}
+	for(i = 0; i < (N - 1); i++) {
+		if(!inc->dirty[i] && (i >= last)) break; /* nothing left to do */
+		for(j = (i + 1), pair_ptr = atom_array[i]->pairs; j < N; j++, pair_ptr = pair_ptr->next) {
+			if(!(inc->dirty[i] || inc->dirty[j])) continue;
 
-					system->A_matrix[ii+p][jj+q] = -3.0*pair_ptr->dimg[p]*pair_ptr->dimg[q]*damp2*ir5;
-					if (system->polar_wolf_full) 
-						system->A_matrix[ii+p][jj+q] -= -3.0*pair_ptr->dimg[p]*pair_ptr->dimg[q]*wdamp2*ir*ir/rcut3;
+			thole_amatrix_block(system, atom_array, i, j, pair_ptr, block);
 
-					/* additional diagonal term */
-					if(p == q) {
-						system->A_matrix[ii+p][jj+q] += damp1*ir3;
-						if ( system->polar_wolf_full ) system->A_matrix[ii+p][jj+q] -= wdamp1/(rcut3);
-					}	
+			for(p = 0; p < 3; p++) {
+				for(q = 0; q < 3; q++) {
+					A[3*i+p][3*j+q] = block[3*p+q];
+					A[3*j+p][3*i+q] = block[3*p+q];
 				}
 			}
+		}
+	}
 
-			/* set the lower half of the tensor component */
-			for(p = 0; p < 3; p++)
-				for(q = 0; q < 3; q++)
-					system->A_matrix[jj+p][ii+q] = system->A_matrix[ii+p][jj+q];
+	/* remember what this matrix was built from */
+	for(i = 0; i < N; i++) {
+		atom_array[i]->thole_index = i + 1;
+		inc->atoms[i] = atom_array[i];
+		inc->polarizability[i] = atom_array[i]->polarizability;
+		memcpy(&(inc->pos[3*i]), atom_array[i]->pos, 3*sizeof(double));
+	}
+	memcpy(inc->basis, system->pbc->basis, sizeof(inc->basis));
+	inc->N = N;
+
+	return;
+}
+
+/* calculate the dipole field tensor */
+void thole_amatrix(system_t *system) {
+
+	int i, j, ii, jj, N, p, q;
+	atom_t **atom_array;
+	pair_t *pair_ptr;
+	double block[9];
+
+	if(system->polar_sparse) {
+		thole_amatrix_sparse(system);
+		return;
+	}
+
+	if(system->polar_amatrix_incremental) {
+		thole_amatrix_incremental(system);
+		return;
+	}
+
+	/* the double precision refinement is done matrix-free, so it needs the sites as well */
+	if(system->polar_single_precision) {
+		thole_matrix_free_pack(system);
+		thole_amatrix_single(system);
+		return;
+	}
+
+	/* the matrix-free contractions only need the sites */
+	if(system->polar_matrix_free) {
+		thole_matrix_free_pack(system);
+		return;
+	}
+
+	//array of atoms generated in pairs.c
+	atom_array = system->atom_array;
+	N = system->natoms;
+
+	zero_out_amatrix(system,N);
+
+	/* set the diagonal blocks */
+	for(i = 0; i < N; i++) {
+		ii = i*3;
+		thole_amatrix_diagonal(atom_array[i], block);
+		for(p = 0; p < 3; p++)
+			system->A_matrix[ii+p][ii+p] = block[4*p];
+	}
+
+	/* calculate each Tij tensor component for each dipole pair */
+	/* every pair writes only its own two blocks, so the rows can go to different threads */
+#ifdef OPENMP
+	#pragma omp parallel for private(j, ii, jj, p, q, pair_ptr, block) schedule(dynamic)
+#endif
+	for(i = 0; i < (N - 1); i++) {
+		ii = i*3;
+		for(j = (i + 1), pair_ptr = atom_array[i]->pairs; j < N; j++, pair_ptr = pair_ptr->next) {
+			jj = j*3;
+
+			thole_amatrix_block(system, atom_array, i, j, pair_ptr, block);
+
+			/* set the upper half and mirror it to the lower half of the tensor component */
+			for(p = 0; p < 3; p++) {
+				for(q = 0; q < 3; q++) {
+					system->A_matrix[ii+p][jj+q] = block[3*p+q];
+					system->A_matrix[jj+p][ii+q] = block[3*p+q];
+				}
+			}
 
 		} /* end j */
 	} /* end i */
@@ -142,10 +552,39 @@ void thole_amatrix(system_t *system) {
 	return;
 }
 
+void free_thole_incremental(thole_incremental_t *inc) {
+
+	if(!inc) return;
+
+	free(inc->atoms);
+	free(inc->pos);
+	free(inc->polarizability);
+	free(inc->map);
+	free(inc->dirty);
+	free(inc->used);
+	free(inc->scratch);
+	free(inc->rows);
+	free(inc);
+
+	return;
+}
+
+void free_thole_sparse(thole_sparse_t *A) {
+
+	if(!A) return;
+
+	free(A->row);
+	free(A->col);
+	free(A->block);
+	free(A);
+
+	return;
+}
+
 /* for uvt runs, resize the A (and B) matrices */
 void thole_resize_matrices(system_t *system) {
 
-	int i, N, dN, oldN;
+	int N, dN, oldN;
 
 	/* determine how the number of atoms has changed and realloc matrices */
 	oldN = 3*system->checkpoint->thole_N_atom; //will be set to zero if first time called
@@ -155,35 +594,15 @@ void thole_resize_matrices(system_t *system) {
 
 	if(!dN) return;
 
-	// grow A matricies by free/malloc (to prevent fragmentation)
-	//free the A matrix
-	for (i=0; i < oldN; i++) free(system->A_matrix[i]);
-	free(system->A_matrix);
+	/* the sparse, incremental, matrix-free and single precision storage is sized by thole_amatrix() */
+	if(system->polar_sparse || system->polar_amatrix_incremental || system->polar_matrix_free || system->polar_single_precision) return;
 
-	//if not iterative, free the B matrix
-	if (!system->polar_iterative) {
-		for (i=0; i < oldN; i++) free(system->B_matrix[i]);
-		free(system->B_matrix);
-	}
+	/* grow the A matrix only when it has run out of room (its contents are rebuilt by thole_amatrix) */
+	thole_matrix_reserve(system, &system->A_matrix, &system->A_block, &system->A_ld, N, 0);
 
-	//(RE)allocate the A matrix
-	system->A_matrix=calloc(N,sizeof(double*));
-	memnullcheck(system->A_matrix,N*sizeof(double*), __LINE__-1, __FILE__);
-
-	for (i=0; i< N; i++ ) {
-		system->A_matrix[i]=malloc(N*sizeof(double));
-		memnullcheck(system->A_matrix[i],N*sizeof(double), __LINE__-1, __FILE__);
-	}
-
-	//(RE)allocate the B matrix if not iterative
-	if (!system->polar_iterative) {
-		system->B_matrix=calloc(N,sizeof(double*));
-		memnullcheck(system->B_matrix,N*sizeof(double*), __LINE__-1, __FILE__);
-		for (i=0; i< N; i++ ) {
-			system->B_matrix[i]=malloc(N*sizeof(double));
-			memnullcheck(system->B_matrix[i],N*sizeof(double),__LINE__-1, __FILE__);
-		}
-	}
+	/* and the B matrix if we need the explicit inverse (the dipoles alone are found by direct solve) */
+	if (!system->polar_iterative && system->polarizability_tensor)
+		thole_matrix_reserve(system, &system->B_matrix, &system->B_block, &system->B_ld, N, 0);
 
 	return;
 }
@@ -252,6 +671,169 @@ void thole_bmatrix_dipoles(system_t *system) {
 }
 
 
+#ifndef VDW
+/* blocked cholesky factorization A = L L^T, in place on the lower triangle of a */
+/* the row-pointer storage makes the inner products run along rows, which the */
+/* tiling keeps in cache; returns 1 if a is not positive-definite */
+static int cholesky_decomp(int n, double **a) {
+
+	int i, j, k, kb, ke, ib, ie, jb, je;
+	double sum, s00, s01, s10, s11;
+
+	for(kb = 0; kb < n; kb += CHOLESKY_BLOCK) {
+		ke = (kb + CHOLESKY_BLOCK < n) ? kb + CHOLESKY_BLOCK : n;
+
+		/* factor the diagonal block */
+		for(j = kb; j < ke; j++) {
+			for(sum = a[j][j], k = kb; k < j; k++) sum -= a[j][k]*a[j][k];
+			if(!(sum > 0.0)) return 1;
+			a[j][j] = sqrt(sum);
+			for(i = j + 1; i < ke; i++) {
+				for(sum = a[i][j], k = kb; k < j; k++) sum -= a[i][k]*a[j][k];
+				a[i][j] = sum/a[j][j];
+			}
+		}
+
+		/* the panel below it */
+		for(i = ke; i < n; i++) {
+			for(j = kb; j < ke; j++) {
+				for(sum = a[i][j], k = kb; k < j; k++) sum -= a[i][k]*a[j][k];
+				a[i][j] = sum/a[j][j];
+			}
+		}
+
+		/* and the rank-CHOLESKY_BLOCK update of the trailing matrix, tile by tile */
+		for(ib = ke; ib < n; ib += CHOLESKY_BLOCK) {
+			ie = (ib + CHOLESKY_BLOCK < n) ? ib + CHOLESKY_BLOCK : n;
+			for(jb = ke; jb <= ib; jb += CHOLESKY_BLOCK) {
+				je = (jb + CHOLESKY_BLOCK < n) ? jb + CHOLESKY_BLOCK : n;
+				/* two rows by two columns at a time, to reuse each load */
+				for(i = ib; i + 1 < ie; i += 2) {
+					for(j = jb; (j + 1 < je) && (j + 1 <= i); j += 2) {
+						s00 = s01 = s10 = s11 = 0;
+						for(k = kb; k < ke; k++) {
+							s00 += a[i][k]*a[j][k];
+							s01 += a[i][k]*a[j+1][k];
+							s10 += a[i+1][k]*a[j][k];
+							s11 += a[i+1][k]*a[j+1][k];
+						}
+						a[i][j] -= s00;
+						a[i][j+1] -= s01;
+						a[i+1][j] -= s10;
+						a[i+1][j+1] -= s11;
+					}
+					for(; (j < je) && (j <= i + 1); j++) {
+						for(s00 = s10 = 0, k = kb; k < ke; k++) {
+							s00 += a[i][k]*a[j][k];
+							s10 += a[i+1][k]*a[j][k];
+						}
+						if(j <= i) a[i][j] -= s00;
+						a[i+1][j] -= s10;
+					}
+				}
+				for(; i < ie; i++) {
+					for(j = jb; (j < je) && (j <= i); j++) {
+						for(sum = 0, k = kb; k < ke; k++) sum += a[i][k]*a[j][k];
+						a[i][j] -= sum;
+					}
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* solve L L^T x = b, overwriting b with x */
+static void cholesky_solve(int n, double **l, double *b) {
+
+	int i, k;
+	double sum;
+
+	/* forward, along the rows of L */
+	for(i = 0; i < n; i++) {
+		for(sum = b[i], k = 0; k < i; k++) sum -= l[i][k]*b[k];
+		b[i] = sum/l[i][i];
+	}
+
+	/* backward with L^T, subtracting each solved column from the remaining rows */
+	for(i = n - 1; i >= 0; i--) {
+		b[i] /= l[i][i];
+		for(k = 0; k < i; k++) b[k] -= l[i][k]*b[i];
+	}
+
+	return;
+}
+
+#else
+extern void dpotrf_(char *, int *, double *, int *, int *);
+extern void dpotrs_(char *, int *, int *, double *, int *, double *, int *, int *);
+
+/* the same through LAPACK, in place: the rows of A are contiguous with leading dimension A_ld */
+/* and A is symmetric, so row/column order doesn't matter */
+static int cholesky_lapack(system_t *system, int n, double *b) {
+
+	int info, nrhs = 1, lda = system->A_ld;
+	char uplo = 'L';
+
+	dpotrf_(&uplo, &n, system->A_block, &lda, &info);
+	if(!info) dpotrs_(&uplo, &n, &nrhs, system->A_block, &lda, b, &n, &info);
+
+	return (info != 0);
+}
+#endif /* VDW */
+
+/* get the dipoles by solving A mu = E directly, without forming the inverse */
+void thole_solve_dipoles(system_t *system) {
+
+	int i, p, N, *indx;
+	atom_t **atom_array = system->atom_array;
+	double *mu_array, d;
+	char linebuf[MAXLINE];
+
+	N = system->natoms;
+
+	mu_array = calloc(3*N, sizeof(double));
+	memnullcheck(mu_array, 3*N*sizeof(double), __LINE__-1, __FILE__);
+
+	for(i = 0; i < N; i++)
+		for(p = 0; p < 3; p++)
+			mu_array[3*i+p] = atom_array[i]->ef_static[p] + atom_array[i]->ef_static_self[p];
+
+#ifdef VDW
+	if(cholesky_lapack(system, 3*N, mu_array)) {
+#else
+	if(cholesky_decomp(3*N, system->A_matrix)) {
+#endif /* VDW */
+		/* a polarization catastrophe leaves A indefinite; fall back to LU on a fresh copy */
+		sprintf(linebuf, "POLAR: A matrix is not positive-definite on step %d, solving by LU decomposition\n", system->step);
+		error(linebuf);
+
+		for(i = 0; i < N; i++)
+			for(p = 0; p < 3; p++)
+				mu_array[3*i+p] = atom_array[i]->ef_static[p] + atom_array[i]->ef_static_self[p];
+		thole_amatrix(system);
+
+		indx = malloc(3*N*sizeof(int));
+		memnullcheck(indx, 3*N*sizeof(int), __LINE__-1, __FILE__);
+		LU_decomp(system->A_matrix, 3*N, indx, &d);
+		LU_bksb(system->A_matrix, 3*N, indx, mu_array);
+		free(indx);
+	}
+#ifndef VDW
+	else
+		cholesky_solve(3*N, system->A_matrix, mu_array);
+#endif /* !VDW */
+
+	for(i = 0; i < N; i++)
+		for(p = 0; p < 3; p++)
+			atom_array[i]->mu[p] = mu_array[3*i+p];
+
+	free(mu_array);
+
+	return;
+}
+
 /* numerical recipes routines for inverting a general matrix */
 
 #define TINY	1.0e-20
@@ -0,0 +1,330 @@
+/*
+
+Space Research Group
+Department of Chemistry
+University of South Florida
+
+Matrix-free Thole contraction, the CPU counterpart of polarization_gpu/polar_cuda.cu.
+Instead of storing the 3N x 3N A matrix, the polarizable sites are packed into flat
+position/polarizability/dipole arrays and the dipole field tensor of each pair is
+evaluated as it is needed, a tile of THOLE_MATRIX_FREE_TILE sites at a time. Within a
+tile the minimum image, the damping and the tensor are straight loops over the sites,
+which the compiler vectorizes; the contraction then runs through the tile in site order.
+
+The tensor is computed with the same arithmetic as thole_amatrix_block() and the terms
+are summed in the same order as the dense contractions, so the dipoles come out as they
+do with the A matrix. Memory is O(N), at the cost of re-evaluating every tensor on every
+contraction.
+
+*/
+
+#include <mc.h>
+
+/* rint() by the 1.5*2^52 shift: the same result for any image count we could meet, */
+/* and unlike rint() it vectorizes without SSE4.1 */
+#define RINT_SHIFT 6755399441055744.0
+
+/* the tile kernel is cloned for AVX-512 and AVX2, and the best one for the host is picked at load time */
+/* (the file is built with -ffp-contract=off, or the AVX-512 clone would fuse multiply-adds and round differently) */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define TILE_CLONES __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define TILE_CLONES
+#endif
+
+#define TILE THOLE_MATRIX_FREE_TILE
+
+/* pack the polarizable sites of the current configuration, in atom array order */
+void thole_matrix_free_pack(system_t *system) {
+
+	int i, s, N;
+	atom_t **aa = system->atom_array;
+	thole_matrix_free_t *mf;
+
+	if(!system->A_matrix_free) {
+		system->A_matrix_free = calloc(1, sizeof(thole_matrix_free_t));
+		memnullcheck(system->A_matrix_free, sizeof(thole_matrix_free_t), __LINE__-1, __FILE__);
+	}
+	mf = system->A_matrix_free;
+
+	for(i = 0, N = 0; i < system->natoms; i++)
+		if(aa[i]->polarizability != 0.0) N++;
+
+	if(system->natoms > mf->max_atoms) {
+		mf->max_atoms = system->natoms;
+		free(mf->site);
+		mf->site = calloc(mf->max_atoms, sizeof(int));
+		memnullcheck(mf->site, mf->max_atoms*sizeof(int), __LINE__-1, __FILE__);
+	}
+	mf->natoms = system->natoms;
+
+	if(N > mf->capacity) {
+		mf->capacity = N;
+		free(mf->atom);
+		free(mf->molecule);
+		free(mf->x);
+		free(mf->y);
+		free(mf->z);
+		free(mf->polarizability);
+		free(mf->charge);
+		free(mf->mux);
+		free(mf->muy);
+		free(mf->muz);
+		mf->atom = calloc(N, sizeof(int));
+		memnullcheck(mf->atom, N*sizeof(int), __LINE__-1, __FILE__);
+		mf->molecule = calloc(N, sizeof(int));
+		memnullcheck(mf->molecule, N*sizeof(int), __LINE__-1, __FILE__);
+		mf->x = calloc(N, sizeof(double));
+		memnullcheck(mf->x, N*sizeof(double), __LINE__-1, __FILE__);
+		mf->y = calloc(N, sizeof(double));
+		memnullcheck(mf->y, N*sizeof(double), __LINE__-1, __FILE__);
+		mf->z = calloc(N, sizeof(double));
+		memnullcheck(mf->z, N*sizeof(double), __LINE__-1, __FILE__);
+		mf->polarizability = calloc(N, sizeof(double));
+		memnullcheck(mf->polarizability, N*sizeof(double), __LINE__-1, __FILE__);
+		mf->charge = calloc(N, sizeof(double));
+		memnullcheck(mf->charge, N*sizeof(double), __LINE__-1, __FILE__);
+		mf->mux = calloc(N, sizeof(double));
+		memnullcheck(mf->mux, N*sizeof(double), __LINE__-1, __FILE__);
+		mf->muy = calloc(N, sizeof(double));
+		memnullcheck(mf->muy, N*sizeof(double), __LINE__-1, __FILE__);
+		mf->muz = calloc(N, sizeof(double));
+		memnullcheck(mf->muz, N*sizeof(double), __LINE__-1, __FILE__);
+	}
+	mf->N = N;
+
+	for(i = 0, s = 0; i < system->natoms; i++) {
+		if(aa[i]->polarizability == 0.0) {
+			mf->site[i] = -1;
+			continue;
+		}
+		mf->site[i] = s;
+		mf->atom[s] = i;
+		/* molecules are only compared, so any label that tells them apart will do */
+		mf->molecule[s] = (i && (system->molecule_array[i] == system->molecule_array[i-1])) ? mf->molecule[s-1] : i;
+		mf->x[s] = aa[i]->pos[0];
+		mf->y[s] = aa[i]->pos[1];
+		mf->z[s] = aa[i]->pos[2];
+		mf->polarizability[s] = aa[i]->polarizability;
+		mf->charge[s] = aa[i]->charge;
+		s++;
+	}
+
+	return;
+}
+
+/* copy the dipoles to be contracted, 3 per atom from mu, or from the atoms if mu is NULL */
+void thole_matrix_free_load(system_t *system, double *mu) {
+
+	int s, i;
+	thole_matrix_free_t *mf = system->A_matrix_free;
+	atom_t **aa = system->atom_array;
+
+	for(s = 0; s < mf->N; s++) {
+		i = mf->atom[s];
+		mf->mux[s] = mu ? mu[3*i] : aa[i]->mu[0];
+		mf->muy[s] = mu ? mu[3*i+1] : aa[i]->mu[1];
+		mf->muz[s] = mu ? mu[3*i+2] : aa[i]->mu[2];
+	}
+
+	return;
+}
+
+/* a gauss-seidel sweep has just changed the dipole of atom i */
+void thole_matrix_free_update(system_t *system, int i) {
+
+	thole_matrix_free_t *mf = system->A_matrix_free;
+	int s = mf->site[i];
+
+	if(s < 0) return;
+	mf->mux[s] = system->atom_array[i]->mu[0];
+	mf->muy[s] = system->atom_array[i]->mu[1];
+	mf->muz[s] = system->atom_array[i]->mu[2];
+
+	return;
+}
+
+/* the 3x3 tensors between site i and sites j0 to j0+n-1, as thole_amatrix_block() builds them */
+/* T[3*p+q][k] is element pq of the tensor with site j0+k; i's own slot, if in the tile, is junk */
+TILE_CLONES
+static void thole_matrix_free_tile(system_t *system, thole_matrix_free_t *mf, int i, int j0, int n, double T[9][TILE]) {
+
+	int k, p, q;
+	double d[3][TILE], r[TILE], ir[TILE], ir3[TILE], ir5[TILE];
+	double damp1[TILE], damp2[TILE], wdamp1[TILE], wdamp2[TILE];
+	double img[3], di, r2, s, v, explr, explrcut;
+	double rcut, rcut2, rcut3, l, l2, l3;
+	double (*basis)[3] = system->pbc->basis;
+	double (*recip)[3] = system->pbc->reciprocal_basis;
+	double xi = mf->x[i], yi = mf->y[i], zi = mf->z[i];
+
+	rcut = system->pbc->cutoff;
+	rcut2 = rcut*rcut; rcut3 = rcut2*rcut;
+	l = system->polar_damp;
+	l2 = l*l; l3 = l2*l;
+
+	/* minimum image, as in minimum_image() */
+	for(k = 0; k < n; k++) {
+		d[0][k] = xi - mf->x[j0+k];
+		d[1][k] = yi - mf->y[j0+k];
+		d[2][k] = zi - mf->z[j0+k];
+
+		for(p = 0; p < 3; p++) {
+			img[p] = 0;
+			img[p] += recip[0][p]*d[0][k];
+			img[p] += recip[1][p]*d[1][k];
+			img[p] += recip[2][p]*d[2][k];
+			img[p] = (img[p] + RINT_SHIFT) - RINT_SHIFT;
+		}
+
+		for(p = 0, r2 = 0; p < 3; p++) {
+			di = 0;
+			di += basis[0][p]*img[0];
+			di += basis[1][p]*img[1];
+			di += basis[2][p]*img[2];
+			d[p][k] -= di;
+			r2 += d[p][k]*d[p][k];
+		}
+		r[k] = sqrt(r2);
+
+		/* inverse displacements */
+		ir[k] = (r[k] == 0.) ? 0 : 1.0/r[k];
+		ir3[k] = (r[k] == 0.) ? MAXVALUE : ir[k]*ir[k]*ir[k];
+		ir5[k] = (r[k] == 0.) ? MAXVALUE : ir[k]*ir[k]*ir[k]*ir[k]*ir[k];
+	}
+
+	//evaluate damping factors
+	switch(system->damp_type) {
+		case DAMPING_OFF:
+			for(k = 0; k < n; k++) {
+				/* the es exclusions of pair_exclusions() */
+				if(((mf->molecule[i] == mf->molecule[j0+k]) && !system->gwp) || (mf->charge[i] == 0.0) || (mf->charge[j0+k] == 0.0))
+					damp1[k] = damp2[k] = wdamp1[k] = wdamp2[k] = 0.0;
+				else
+					damp1[k] = damp2[k] = wdamp1[k] = wdamp2[k] = 1.0;
+			}
+			break;
+		case DAMPING_LINEAR:
+			for(k = 0; k < n; k++) {
+				s = l * pow(mf->polarizability[i]*mf->polarizability[j0+k], 1.0/6.0);
+				v = r[k]/s;
+				if(r[k] < s) {
+					damp1[k] = (4.0 - 3.0*v)*v*v*v;
+					damp2[k] = v*v*v*v;
+				} else {
+					damp1[k] = damp2[k] = 1.0;
+				}
+				wdamp1[k] = wdamp2[k] = 0;
+			}
+			break;
+		case DAMPING_EXPONENTIAL:
+			explrcut = exp(-l*rcut);
+			for(k = 0; k < n; k++) {
+				explr = exp(-l*r[k]);
+				r2 = r[k]*r[k];
+				damp1[k] = 1.0 - explr*(0.5*l2*r2 + l*r[k] + 1.0);
+				damp2[k] = damp1[k] - explr*(l3*r2*r[k]/6.0);
+				//subtract off damped interaction at r_cutoff
+				wdamp1[k] = 1.0 - explrcut*(0.5*l2*rcut2+l*rcut+1.0);
+				wdamp2[k] = wdamp1[k] - explrcut*(l3*rcut3/6.0);
+			}
+			break;
+		default:
+			error("error: something unexpected happened in thole_matrix_free.c");
+	}
+
+	/* build the tensor */
+	for(p = 0; p < 3; p++) {
+		for(q = 0; q < 3; q++) {
+			for(k = 0; k < n; k++) {
+				T[3*p+q][k] = -3.0*d[p][k]*d[q][k]*damp2[k]*ir5[k];
+				if(system->polar_wolf_full)
+					T[3*p+q][k] -= -3.0*d[p][k]*d[q][k]*wdamp2[k]*ir[k]*ir[k]/rcut3;
+			}
+			/* additional diagonal term */
+			if(p == q) {
+				for(k = 0; k < n; k++) {
+					T[3*p+q][k] += damp1[k]*ir3[k];
+					if(system->polar_wolf_full) T[3*p+q][k] -= wdamp1[k]/(rcut3);
+				}
+			}
+		}
+	}
+
+	return;
+}
+
+/* ef -= sum_j T_ij mu_j over the sites j != i, dipole by dipole as contract_dipoles() takes them from the A matrix */
+void thole_matrix_free_field(system_t *system, int i, double *ef) {
+
+	int j0, k, n, p, si;
+	thole_matrix_free_t *mf = system->A_matrix_free;
+	double T[9][TILE];
+
+	si = mf->site[i];
+
+	for(j0 = 0; j0 < mf->N; j0 += TILE) {
+		n = (mf->N - j0 < TILE) ? mf->N - j0 : TILE;
+		thole_matrix_free_tile(system, mf, si, j0, n, T);
+
+		for(k = 0; k < n; k++) {
+			if(j0 + k == si) continue;
+			for(p = 0; p < 3; p++)
+				ef[p] -= T[3*p][k]*mf->mux[j0+k] + T[3*p+1][k]*mf->muy[j0+k] + T[3*p+2][k]*mf->muz[j0+k];
+		}
+	}
+
+	return;
+}
+
+/* out = the three rows of A for atom i times the loaded dipoles, element by element as the dense matvec sums them */
+void thole_matrix_free_matvec(system_t *system, int i, double *out) {
+
+	int j0, k, n, p, si;
+	thole_matrix_free_t *mf = system->A_matrix_free;
+	double T[9][TILE];
+	double diagonal[9];
+
+	si = mf->site[i];
+	thole_amatrix_diagonal(system->atom_array[i], diagonal);
+	out[0] = out[1] = out[2] = 0;
+
+	for(j0 = 0; j0 < mf->N; j0 += TILE) {
+		n = (mf->N - j0 < TILE) ? mf->N - j0 : TILE;
+		thole_matrix_free_tile(system, mf, si, j0, n, T);
+
+		/* the diagonal block goes in at its own place */
+		for(k = 0; k < n; k++) {
+			if(j0 + k == si)
+				for(p = 0; p < 3; p++)
+					T[3*p][k] = diagonal[3*p], T[3*p+1][k] = diagonal[3*p+1], T[3*p+2][k] = diagonal[3*p+2];
+			for(p = 0; p < 3; p++) {
+				out[p] += T[3*p][k]*mf->mux[j0+k];
+				out[p] += T[3*p+1][k]*mf->muy[j0+k];
+				out[p] += T[3*p+2][k]*mf->muz[j0+k];
+			}
+		}
+	}
+
+	return;
+}
+
+void free_thole_matrix_free(thole_matrix_free_t *mf) {
+
+	if(!mf) return;
+
+	free(mf->atom);
+	free(mf->site);
+	free(mf->molecule);
+	free(mf->x);
+	free(mf->y);
+	free(mf->z);
+	free(mf->polarizability);
+	free(mf->charge);
+	free(mf->mux);
+	free(mf->muy);
+	free(mf->muz);
+	free(mf);
+
+	return;
+}